@@ -0,0 +1,60 @@
+#ifndef API_Actuator_h
+#define API_Actuator_h
+
+#include "Arduino.h"
+#include "API_Pwm.h"
+#include "API_Snapshot.h"
+
+// Contadores de una salida
+struct Actuator_stats{
+      uint32_t requests;            // set() recibidos
+      uint32_t changes;             // set() con un objetivo distinto del vigente
+      uint32_t writes;              // escrituras efectivas al LEDC
+      uint32_t last_latency_us;     // pedido -> primera aplicación, último cambio
+      uint32_t max_latency_us;
+    };
+
+// Estado publicado para lectores de otras tareas
+struct Actuator_status{
+      float target;
+      float output;                 // valor aplicado (sigue la rampa)
+      Actuator_stats stats;
+    };
+
+// Salida PWM con detección de cambios y límite de rampa. Sin rampa el
+// objetivo se aplica en el mismo set(); con rampa (en %/s, por sentido;
+// 0 = sin límite) lo aplica update(), que además avanza el dithering.
+// Con rampa, update() es el único que escribe: llamarlo a tasa fija.
+// set(), set_ramp() y update() son de una sola tarea (la dueña de la
+// salida); las demás leen get_*() del snapshot que publican
+class API_Actuator {
+public:
+    API_Actuator(int pin, int channel, uint32_t freq, uint8_t bits, bool dither = false);
+    bool begin();
+    void set(float percent);
+    void set_ramp(float up_pct_s, float down_pct_s);
+    void update();
+    float get_target() const { return __status.read().target; }
+    float get_output() const { return __status.read().output; }
+    uint8_t get_bits() { return __pwm.get_bits(); }
+    Actuator_stats get_stats() const { return __status.read().stats; }
+
+private:
+    API_Pwm __pwm;
+    float __target;
+    float __output;                 // valor aplicado (sigue la rampa)
+    float __ramp_up;
+    float __ramp_down;
+    bool __pending;                 // cambio todavía sin aplicar
+    unsigned long __request_us;
+    unsigned long __update_us;
+    bool __updated;
+    Actuator_stats __stats;
+    API_Snapshot<Actuator_status> __status;
+
+    bool ramped() { return __ramp_up > 0 || __ramp_down > 0; }
+    void apply(float percent);
+    void publish();
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef API_ControlLoop_h
+#define API_ControlLoop_h
+
+#include "Arduino.h"
+#include "API_Snapshot.h"
+
+// Lazo de control a tasa fija: un esp_timer periódico sólo despierta a una
+// tarea de alta prioridad que corre el paso con el dt real medido. La tarea
+// va en el núcleo de loop() (1): el paso nunca se intercala con loop() a
+// mitad de una escritura del calefactor
+#define CONTROL_PERIOD_US   1000000UL
+#define CONTROL_CORE        1
+#define CONTROL_PRIORITY    10
+#define CONTROL_STACK       4096
+// Un paso que termina más de CONTROL_DEADLINE_US después de su tick
+// planificado (o un tick perdido) cuenta como deadline incumplido
+#define CONTROL_DEADLINE_US 100000UL
+// Histograma del retardo de arranque respecto del tick: el bin 0 cubre
+// [0, CONTROL_JITTER_BIN0_US), cada bin siguiente duplica el ancho y el
+// último acumula el resto
+#define CONTROL_JITTER_BINS    10
+#define CONTROL_JITTER_BIN0_US 50
+
+struct Control_stats{
+      uint32_t steps;
+      uint32_t misses;              // deadlines incumplidos + ticks perdidos
+      uint32_t jitter_hist[CONTROL_JITTER_BINS];
+      int32_t last_jitter_us;       // arranque - tick planificado
+      uint32_t max_jitter_us;
+      uint32_t last_exec_us;        // duración del paso
+      uint32_t max_exec_us;
+      float last_dt_s;              // dt real entregado al paso
+    };
+
+// Paso de control: dt_s = tiempo real desde el paso anterior
+typedef void (*Control_step_fn)(float dt_s, void* arg);
+
+class API_ControlLoop {
+public:
+    API_ControlLoop();
+    bool begin(Control_step_fn step, void* arg, uint32_t period_us = CONTROL_PERIOD_US);
+    // Un paso en el instante now_us (esp_timer_get_time()); lo llama la tarea
+    void run_step(int64_t now_us);
+    Control_stats get_stats() const { return __published.read(); }
+    uint32_t get_period_us() { return __period_us; }
+    // Límite superior (us) del bin i del histograma; 0 = sin límite
+    static uint32_t bin_limit_us(int i) {
+      return i < CONTROL_JITTER_BINS - 1 ? (uint32_t)CONTROL_JITTER_BIN0_US << i : 0;
+    }
+
+private:
+    Control_step_fn __step;
+    void* __arg;
+    uint32_t __period_us;
+    void* __timer;
+    void* __task;
+    bool __started;
+    int64_t __due_us;               // tick planificado del próximo paso
+    int64_t __last_us;              // arranque del paso anterior
+    Control_stats __stats;
+    API_Snapshot<Control_stats> __published;
+
+    static void onTimer(void* arg);
+    static void task(void* arg);
+};
+
+#endif
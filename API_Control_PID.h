@@ -2,6 +2,7 @@
 #define API_Control_PID_h
  
 #include "Arduino.h"
+#include "API_Pid.h"
 
 struct PID_config{
       // variables del proceso control
@@ -12,18 +13,31 @@ struct PID_config{
       float u_max; float u_min;    
     };
     
+// Envoltorio en float sobre Pid_math<float> (API_Pid.h): configuración en
+// tiempo de ejecución o por Config de compilación
 class API_Control_PID {
 public:
     API_Control_PID();
     void configure(PID_config PID_data_in);
+    template <typename Config>
+    void configure() {
+      __coefs = Pid<float, Config>::coefs();
+      PID_data.KP = Config::kp(); PID_data.KI = Config::ki(); PID_data.Ts = Config::ts();
+      PID_data.Kb = Config::kb(); PID_data.u_max = Config::u_max(); PID_data.u_min = Config::u_min();
+      isConfigure = true;
+    }
+    void set_reference(float y_ref) { PID_data.y_ref = y_ref; }
     float update(float data_in);
+    // Paso con el dt real (s) en el integrador en lugar de Ts
+    float update(float data_in, float dt_s);
   
 private:
     PID_config PID_data;
+    Pid_coefs<float> __coefs;   // KI*Ts precalculado
     bool isConfigure;
 
     void init();
 
 };
 
-#endif
+#endif
@@ -2,12 +2,51 @@
 #define API_HTTP_SERVER_H
 
 #include <Arduino.h>
+#include "API_Sensors.h"
+
+// Backend del servidor HTTP, elegido en compilación (mismas rutas):
+//   HTTP_BACKEND_WEBSERVER -> WebServer de Arduino atendido desde loop()
+//                             (por defecto)
+//   HTTP_BACKEND_IDF       -> esp_http_server en su propia tarea, con pool
+//                             acotado de conexiones keep-alive
+// Ej.: build_flags = -DHTTP_BACKEND=HTTP_BACKEND_IDF
+#define HTTP_BACKEND_WEBSERVER 0
+#define HTTP_BACKEND_IDF       1
+#ifndef HTTP_BACKEND
+#define HTTP_BACKEND HTTP_BACKEND_WEBSERVER
+#endif
+
+// Respuesta JSON más grande (/api/state): parte fija (config, control,
+// energía, actuadores) más el peor caso por sensor (temperatura,
+// resolución, salud y energía por nodo, ~190 bytes)
+#define HTTP_JSON_FIXED      2048
+#define HTTP_JSON_PER_SENSOR 224
+#define HTTP_JSON_BUF        (HTTP_JSON_FIXED + HTTP_JSON_PER_SENSOR * DEVICES_CONNECT)
+
+#define HTTP_STREAM_CLIENTS   4      // suscriptores de /api/stream
+
+// Sólo HTTP_BACKEND_IDF. Conexiones simultáneas: todos los suscriptores
+// del stream más HTTP_REQUEST_CONNECTIONS para pedidos comunes, dentro de
+// CONFIG_LWIP_MAX_SOCKETS - 3. Al llenarse se cierra la sesión menos usada;
+// los streams renuevan su uso en cada frame, así que se cierran keep-alive
+// ociosos y no suscriptores.
+// La tarea corre en el core 0, lejos del lazo de control (core 1)
+#define HTTP_REQUEST_CONNECTIONS 3
+#define HTTP_MAX_CONNECTIONS  (HTTP_STREAM_CLIENTS + HTTP_REQUEST_CONNECTIONS)
+#define HTTP_TASK_CORE        0
+#define HTTP_TASK_PRIORITY    5
+#define HTTP_TASK_STACK       (6144 + HTTP_JSON_BUF)
+#define HTTP_MAX_URI_HANDLERS 48
+#define HTTP_TIMEOUT_S        5      // espera máx. de recv/send por pedido
+#define HTTP_QUERY_MAX        256
+#define HTTP_BODY_MAX         1024
+#define HTTP_ARG_MAX          64
 
 // Inicializa WiFi (modo AP) y el servidor HTTP con rutas
 void httpServerSetup();
 
-// Atiende peticiones entrantes; llamarlo frecuentemente en loop()
+// Atiende peticiones entrantes; llamarlo frecuentemente en loop(). Con
+// HTTP_BACKEND_IDF sólo agenda el envío del stream SSE a la tarea HTTP
 void httpServerLoop();
 
 #endif
-
@@ -0,0 +1,67 @@
+#ifndef API_JsonWriter_h
+#define API_JsonWriter_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "API_SensorBus.h"
+
+// Escritor JSON en streaming sobre un búfer del llamador: sin heap, las
+// comas entre elementos las pone solo. Si el documento no entra, ok()
+// devuelve false y el contenido queda truncado (no enviarlo).
+// Los float se formatean con aritmética entera a los decimales pedidos;
+// NaN/inf y los valores que, escalados, no entran en int64 salen como null
+#define JSON_MAX_DEPTH    8
+#define JSON_MAX_DECIMALS 6
+
+class API_JsonWriter {
+public:
+    API_JsonWriter(char* buf, size_t capacity);
+    void reset();
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+    void key(const char* name);
+
+    void value(bool v);
+    void value(int v) { putInt(v < 0, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v); }
+    void value(unsigned int v) { putInt(false, v); }
+    void value(long v) { putInt(v < 0, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v); }
+    void value(unsigned long v) { putInt(false, v); }
+    void value(long long v) { putInt(v < 0, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v); }
+    void value(unsigned long long v) { putInt(false, v); }
+    void value(float v, uint8_t decimals);
+    void value(const char* s);          // cadena con escapes
+    void value_temp(Temp_raw raw);      // °C con 2 decimales desde 1/16 °C
+    void value_null();
+    // Fragmento JSON ya formado (literal), como un valor
+    void value_raw(const char* json);
+
+    // key + value
+    template <typename V>
+    void field(const char* name, V v) { key(name); value(v); }
+    void field(const char* name, float v, uint8_t decimals) { key(name); value(v, decimals); }
+
+    const char* c_str() const { return __buf; }
+    size_t length() const { return __len; }
+    bool ok() const { return !__overflow; }
+
+private:
+    char* __buf;
+    size_t __cap;
+    size_t __len;
+    bool __overflow;
+    uint8_t __depth;
+    uint8_t __first;                // bit d = contenedor d todavía vacío
+    bool __after_key;
+
+    void separator();
+    void put(char c);
+    void put(const char* s, size_t n);
+    void putInt(bool neg, unsigned long long mag);
+    void open(char c);
+    void close(char c);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef API_Pid_h
+#define API_Pid_h
+
+#include <stdint.h>
+
+// Núcleo PI de la barra, sólo cabecera (misma ley que API_Control_PID):
+//   u = KP*(Kb*y_ref - y) + I,  saturada a [u_min, u_max]
+//   I += KI*Ts*(y_ref - y)
+// Pid<T, Config> con T = float, Q16_16 o int32_t. Config da las ganancias
+// como funciones static constexpr (kp, ki, ts, kb, u_max, u_min); los
+// coeficientes, KI*Ts incluido, se calculan al compilar.
+// En punto fijo las ganancias van en Q16.16, el producto en 64 bits y el
+// integrador en Q16 de unidades de u (KI*Ts chico no se pierde por
+// truncamiento). Con int32_t las señales van en unidades enteras del
+// llamador: Config::y_units() cuentas por unidad de y (16 para Temp_raw)
+// y Config::u_units() cuentas por unidad de u
+
+// 16 bits enteros, 16 fraccionarios
+struct Q16_16 {
+      int32_t raw;
+
+      static constexpr Q16_16 from_float(float x) {
+        return Q16_16{ (int32_t)(x * 65536.0f + (x < 0 ? -0.5f : 0.5f)) };
+      }
+      float to_float() const { return raw / 65536.0f; }
+    };
+
+// Coeficientes precalculados de un controlador
+template <typename C>
+struct Pid_coefs {
+      C kp;
+      C ki_ts;
+      C kb;
+      C u_max;
+      C u_min;
+    };
+
+template <typename T> struct Pid_math;
+
+template <>
+struct Pid_math<float> {
+    typedef float coef_t;
+    typedef float acc_t;
+
+    static constexpr Pid_coefs<float> coefs(float kp, float ki, float ts, float kb, float u_max, float u_min) {
+      return Pid_coefs<float>{ kp, ki * ts, kb, u_max, u_min };
+    }
+    template <typename Config>
+    static constexpr Pid_coefs<float> coefs() {
+      return coefs(Config::kp(), Config::ki(), Config::ts(), Config::kb(), Config::u_max(), Config::u_min());
+    }
+    static float raw(float v) { return v; }
+    static float make(float v) { return v; }
+
+    // dt_ratio = dt real / Ts: escala el paso del integrador
+    static inline float step(const Pid_coefs<float>& k, float& integ, float y_ref, float y, float dt_ratio = 1.0f) {
+      float u = k.kp * (k.kb * y_ref - y) + integ;
+      if (u > k.u_max) u = k.u_max;
+      else if (u < k.u_min) u = k.u_min;
+      integ += k.ki_ts * dt_ratio * (y_ref - y);
+      return u;
+    }
+};
+
+// Aritmética común a Q16_16 e int32_t: señales int32 (en unidades de y/u),
+// ganancias Q16.16, límites en unidades de u
+struct Pid_fixed_math {
+    typedef int32_t coef_t;
+    typedef int64_t acc_t;
+
+    static constexpr int32_t round32(float x) { return (int32_t)(x + (x < 0 ? -0.5f : 0.5f)); }
+    static constexpr Pid_coefs<int32_t> coefs(float kp, float ki, float ts, float kb, float u_max, float u_min,
+                                              float y_units, float u_units) {
+      return Pid_coefs<int32_t>{ round32(kp * u_units / y_units * 65536.0f),
+                                 round32(ki * ts * u_units / y_units * 65536.0f),
+                                 round32(kb * 65536.0f),
+                                 round32(u_max * u_units),
+                                 round32(u_min * u_units) };
+    }
+
+    static inline int32_t step(const Pid_coefs<int32_t>& k, int64_t& integ, int32_t y_ref, int32_t y) {
+      int32_t e_p = (int32_t)(((int64_t)k.kb * y_ref + 0x8000) >> 16) - y;
+      int64_t u = (int64_t)k.kp * e_p + integ;
+      int32_t out = (int32_t)((u + 0x8000) >> 16);
+      if (out > k.u_max) out = k.u_max;
+      else if (out < k.u_min) out = k.u_min;
+      integ += (int64_t)k.ki_ts * (y_ref - y);
+      return out;
+    }
+};
+
+template <>
+struct Pid_math<Q16_16> : Pid_fixed_math {
+    template <typename Config>
+    static constexpr Pid_coefs<int32_t> coefs() {
+      return Pid_fixed_math::coefs(Config::kp(), Config::ki(), Config::ts(), Config::kb(),
+                                   Config::u_max(), Config::u_min(), 65536.0f, 65536.0f);
+    }
+    static int32_t raw(Q16_16 v) { return v.raw; }
+    static Q16_16 make(int32_t v) { return Q16_16{ v }; }
+};
+
+template <>
+struct Pid_math<int32_t> : Pid_fixed_math {
+    template <typename Config>
+    static constexpr Pid_coefs<int32_t> coefs() {
+      return Pid_fixed_math::coefs(Config::kp(), Config::ki(), Config::ts(), Config::kb(),
+                                   Config::u_max(), Config::u_min(), Config::y_units(), Config::u_units());
+    }
+    static int32_t raw(int32_t v) { return v; }
+    static int32_t make(int32_t v) { return v; }
+};
+
+template <typename T, typename Config>
+class Pid {
+public:
+    typedef Pid_math<T> M;
+    typedef typename M::coef_t coef_t;
+
+    // Constantes de compilación: update() no recalcula nada
+    static constexpr Pid_coefs<coef_t> coefs() { return M::template coefs<Config>(); }
+
+    Pid() : __integ(0), __y_ref(), __u() {}
+    void set_reference(T y_ref) { __y_ref = y_ref; }
+    T get_reference() const { return __y_ref; }
+    T update(T y) {
+      __u = M::make(M::step(coefs(), __integ, M::raw(__y_ref), M::raw(y)));
+      return __u;
+    }
+    T output() const { return __u; }
+    void reset() { __integ = 0; }
+
+private:
+    typename M::acc_t __integ;
+    T __y_ref;
+    T __u;
+};
+
+#endif
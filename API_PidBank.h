@@ -0,0 +1,60 @@
+#ifndef API_PidBank_h
+#define API_PidBank_h
+
+#include <stdint.h>
+#include "API_Pid.h"
+
+// Banco de N lazos PI en float (misma ley que Pid<float, Config>) guardado
+// como estructura de arreglos: update() recorre todos los canales en una
+// pasada sin saltos (saturación por selección), que el compilador puede
+// vectorizar en host y que en el ESP32 queda en un bucle corto sobre la FPU.
+// Un canal deshabilitado da u = 0 y no integra
+template <int N>
+class Pid_bank {
+public:
+    Pid_bank() {
+      for (int i = 0; i < N; i++) {
+        __kp[i] = 0; __ki_ts[i] = 0; __kb[i] = 0; __u_max[i] = 0; __u_min[i] = 0;
+        __integ[i] = 0; __y_ref[i] = 0; __on[i] = 0;
+      }
+    }
+    static int size() { return N; }
+
+    void configure(int ch, const Pid_coefs<float>& k) {
+      __kp[ch] = k.kp; __ki_ts[ch] = k.ki_ts; __kb[ch] = k.kb;
+      __u_max[ch] = k.u_max; __u_min[ch] = k.u_min;
+      __on[ch] = 1;
+    }
+    template <typename Config>
+    void configure(int ch) { configure(ch, Pid<float, Config>::coefs()); }
+    void set_reference(int ch, float y_ref) { __y_ref[ch] = y_ref; }
+    float get_reference(int ch) const { return __y_ref[ch]; }
+    void enable(int ch, bool on) { __on[ch] = on ? 1 : 0; }
+    bool enabled(int ch) const { return __on[ch] != 0; }
+    void reset(int ch) { __integ[ch] = 0; }
+    float integrator(int ch) const { return __integ[ch]; }
+
+    // Un paso de todos los canales: y[i] medido -> u[i]
+    void update(const float* y, float* u) {
+      for (int i = 0; i < N; i++) {
+        float on = __on[i];
+        float v = __kp[i] * (__kb[i] * __y_ref[i] - y[i]) + __integ[i];
+        v = v > __u_max[i] ? __u_max[i] : v;
+        v = v < __u_min[i] ? __u_min[i] : v;
+        u[i] = v * on;
+        __integ[i] += on * __ki_ts[i] * (__y_ref[i] - y[i]);
+      }
+    }
+
+private:
+    alignas(16) float __kp[N];
+    alignas(16) float __ki_ts[N];
+    alignas(16) float __kb[N];
+    alignas(16) float __u_max[N];
+    alignas(16) float __u_min[N];
+    alignas(16) float __integ[N];
+    alignas(16) float __y_ref[N];
+    alignas(16) float __on[N];      // 1 = habilitado (float: sin saltos en update)
+};
+
+#endif
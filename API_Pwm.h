@@ -0,0 +1,47 @@
+#ifndef API_Pwm_h
+#define API_Pwm_h
+
+#include "Arduino.h"
+
+// Salida PWM por LEDC con ciclo de trabajo en float (0..100 %).
+// La resolución pedida se reduce en begin() si el reloj del LEDC no
+// alcanza para la frecuencia: bits <= log2(80 MHz / freq), ej. 16 bits a
+// 1 kHz, 13 bits a 5 kHz
+#define PWM_LEDC_CLOCK_HZ 80000000UL
+#define PWM_MAX_BITS      16
+
+class API_Pwm {
+public:
+    API_Pwm(int pin, int channel, uint32_t freq, uint8_t bits, bool dither = false);
+    // Configura el canal; devuelve false si ninguna resolución es válida
+    bool begin();
+    // Sin dithering escribe el código redondeado en el acto; con dithering
+    // sólo fija el objetivo y la salida la actualiza update(). Un código
+    // igual al último escrito no vuelve al LEDC; devuelve si escribió
+    bool write(float percent);
+    // Dithering sigma-delta de primer orden: escribe el código truncado y
+    // arrastra la fracción de LSB al siguiente paso, así la media sigue al
+    // objetivo con resolución por debajo de 1 LSB. Llamar a tasa fija
+    bool update();
+    void set_dither(bool enable) { __dither = enable; }
+    bool get_dither() { return __dither; }
+    float get_percent() { return __percent; }
+    uint32_t get_duty() { return __duty; }
+    uint8_t get_bits() { return __bits; }
+
+private:
+    int __pin;
+    int __channel;
+    uint32_t __freq;
+    uint8_t __bits;
+    volatile bool __dither;
+    volatile float __percent;
+    volatile float __target;       // en cuentas, 0..2^bits
+    float __error;                 // fracción arrastrada por el sigma-delta
+    uint32_t __duty;               // último código escrito
+    bool __written;                // __duty ya está en el LEDC
+
+    bool writeDuty(uint32_t duty);
+};
+
+#endif
@@ -2,39 +2,154 @@
 #define API_Resistor_h
  
 #include "Arduino.h"
+#include "API_Snapshot.h"
+#include "API_Actuator.h"
+#include "API_Sensors.h"
 
 // define output resistor PWM
 #define RESISTOR_PIN_OUT     27
 #define RESISTOR_FREQ        1000
 #define RESISTOR_CHANNEL     0
-#define RESISTOR_RESOLUTION  8
+#define RESISTOR_RESOLUTION  14     // 16384 niveles (máx. 16 a 1 kHz)
+#define RESISTOR_PWM_DITHER  false  // sigma-delta, paso en cada ventana del ADC
+// Rampa de la salida en %/s (0 = sin límite). El PWM lo escribe siempre la
+// tarea del ADC, antes de cada ventana. Bajar nunca se limita: apagar es
+// inmediato
+#define RESISTOR_RAMP_UP     0
 
 // define analog input mean voltage
 #define HEAT_PIN_AN_IN       32
 
 
+// Adquisición de potencia en segundo plano: ventanas de RESISTOR_ADC_SAMPLES
+// muestras equiespaciadas sobre RESISTOR_ADC_PERIODS periodos PWM completos
+// (coprimos: cada muestra cae en una fase distinta del ciclo), promediando
+// la potencia instantánea V^2/R. Una ventana cada RESISTOR_ADC_INTERVAL_MS
+#define RESISTOR_ADC_SAMPLES     64
+#define RESISTOR_ADC_PERIODS     5
+#define RESISTOR_ADC_INTERVAL_MS 50
+#define RESISTOR_ADC_CORE        0
+#define RESISTOR_ADC_PRIORITY    1
+#define RESISTOR_ADC_STACK       2048
+
 // define data of resistor & conversion
 #define RESISTOR_VALUE          10.3 // OHM (at 20°C)
 #define READ_TO_REAL_VOLTAGE    1.4818 // 3.3V(read) --> 4.89V (real)
 
+// Calibración: tabla código ADC (12 bits) -> potencia, construida al
+// arrancar con la característica de eFuse (o Vref por defecto) o con una
+// calibración de dos puntos guardada en NVS. LSB = 0.1 mW
+#define RESISTOR_ADC_CODES      4096
+#define RESISTOR_LUT_PER_W      10000.0f
+#define RESISTOR_DEFAULT_VREF   1100   // mV, si el eFuse no tiene datos
+#define RESISTOR_CAL_NAMESPACE  "heater"
+#define RESISTOR_CAL_MV_MAX     3900   // mV máx. en el pin con 11 dB
+// Coeficiente de temperatura de la resistencia (1/°C; 0 = sin corrección):
+// R(T) = RESISTOR_VALUE * (1 + RESISTOR_TEMPCO * (T - RESISTOR_TEMP_REF))
+#define RESISTOR_TEMPCO         0.0
+#define RESISTOR_TEMP_REF       20.0
+
+// Energía: cada ventana integra su potencia media por el tiempo desde la
+// ventana anterior (tasa fija de la tarea). Un hueco mayor que
+// RESISTOR_ENERGY_MAX_DT_US (arranque, tarea demorada) se recorta
+#define RESISTOR_ENERGY_MODES     2     // 0 = fijo, 1 = PID
+#define RESISTOR_ENERGY_NODES     DEVICES_CONNECT   // 0 = ambiente, 1.. = nodos
+#define RESISTOR_ENERGY_MAX_DT_US 500000
+
+// Origen de la calibración vigente
+enum Resistor_cal {
+      RESISTOR_CAL_DEFAULT_VREF,
+      RESISTOR_CAL_EFUSE_VREF,
+      RESISTOR_CAL_EFUSE_TP,
+      RESISTOR_CAL_TWO_POINT
+    };
+
+// Energía entregada, publicada por la tarea del ADC tras cada ventana
+struct Heater_energy{
+      float total_j;                // desde el arranque
+      float run_j;                  // corrida en curso o la última
+      float run_s;
+      float run_duty;               // % PWM medio de la corrida
+      bool run_active;
+      uint8_t run_mode;
+      float mode_j[RESISTOR_ENERGY_MODES];   // acumulado de corridas por modo
+      float node_j[RESISTOR_ENERGY_NODES];   // acumulado de corridas por nodo seleccionado
+    };
+
 class API_Resistor {
 public:
     API_Resistor();
     void init();
-    void set_pwm(int percent);
-    float get_heat();
-    int get_set_pwm_percent() { return __actual_set_pwm_percent; }
+    // Ciclo de trabajo en % (float: sin truncar a niveles enteros). Desde
+    // cualquier tarea: sólo deja el pedido, que update_output() aplica
+    void set_pwm(float percent);
+    // Aplica el último set_pwm() y avanza rampa/dithering. Sólo la tarea
+    // del ADC (dueña de la salida), antes de cada ventana
+    void update_output();
+    // Lanza la tarea de adquisición del ADC
+    bool begin_sampling();
+    // Una ventana de adquisición completa (bloquea ~RESISTOR_ADC_PERIODS ms)
+    void sample_window();
+    // Potencia media de la última ventana; no toca el ADC
+    float get_heat() { return __last_calc_heat; }
+    uint32_t get_heat_windows() { return __heat_windows; }
+    // Calibración de dos puntos (código ADC, mV en el pin), guardada en NVS;
+    // load_calibration() la recupera (requiere NVS iniciado, desde setup())
+    bool set_two_point_calibration(uint16_t raw_lo, uint16_t mv_lo, uint16_t raw_hi, uint16_t mv_hi);
+    void load_calibration();
+    Resistor_cal get_calibration() { return __cal; }
+    // Temperatura de la resistencia para corregir RESISTOR_VALUE
+    void set_temperature(float tempC);
+    float get_set_pwm_percent() { return __actual_set_pwm_percent; }
+    // Salida efectiva (tras la rampa) y contadores de escritura, del
+    // snapshot de la salida
+    float get_pwm_output() { return __out.get_output(); }
+    uint8_t get_pwm_bits() { return __out.get_bits(); }
+    void set_ramp(float up_pct_s) { __out.set_ramp(up_pct_s, 0); }
+    Actuator_stats get_pwm_stats() { return __out.get_stats(); }
+    // Contabilidad de energía por corrida; los pedidos se aplican en la
+    // próxima ventana del ADC (único escritor de los acumuladores)
+    void begin_run(uint8_t mode) { __run_mode = mode; __run_request = RUN_BEGIN; }
+    void end_run() { __run_request = RUN_END; }
+    void set_energy_node(uint8_t node) { __energy_node = node; }
+    Heater_energy get_energy() const { return __energy.read(); }
   
 private:
-    int __pin_out;
-    int __channel;
+    API_Actuator __out;
     int __freq;
-    int __resolution;
     int __pin_analog_in;
 
-    int __actual_set_pwm_percent;
-    float __last_calc_heat;
+    volatile float __actual_set_pwm_percent;
+    volatile float __last_calc_heat;
+    volatile uint32_t __heat_windows;
+
+    // Potencia por código ADC (RESISTOR_LUT_PER_W por W) y versión de la
+    // tabla: una ventana que la vio cambiar se descarta
+    uint16_t __power_lut[RESISTOR_ADC_CODES];
+    volatile uint32_t __lut_version;
+    Resistor_cal __cal;
+    volatile float __r_scale;      // RESISTOR_VALUE / R(T)
+
+    // Acumuladores en uJ y %*us (enteros: sin pérdida en corridas largas)
+    enum Run_request { RUN_NONE, RUN_BEGIN, RUN_END };
+    volatile uint8_t __run_request;
+    volatile uint8_t __run_mode;
+    volatile uint8_t __energy_node;
+    bool __run_active;
+    unsigned long __energy_last_us;
+    uint64_t __total_uj;
+    uint64_t __run_uj;
+    uint64_t __run_us;
+    uint64_t __run_duty;
+    uint64_t __mode_uj[RESISTOR_ENERGY_MODES];
+    uint64_t __node_uj[RESISTOR_ENERGY_NODES];
+    API_Snapshot<Heater_energy> __energy;
+
+    void buildLut(const uint16_t* two_point);
+    void integrateEnergy(float watts);
+
+    static void task(void* arg);
 
 };
  
-#endif
+#endif
@@ -0,0 +1,65 @@
+#ifndef API_RunConfig_h
+#define API_RunConfig_h
+
+#include "Arduino.h"
+#include "API_Snapshot.h"
+#include "API_Sensors.h"
+
+// Configuración de la corrida que fija la API: modo, nodo, setpoint y
+// porcentajes. Cada cambio valida el pedido completo y publica la
+// configuración entera con una versión nueva: loop() y el lazo de control
+// nunca ven un cambio aplicado a medias. Un único escritor (la tarea HTTP)
+#define RUN_MODE_FIXED 0
+#define RUN_MODE_PID   1
+
+// Campos presentes en un Run_config_patch
+#define RUN_CFG_MODE     (1 << 0)
+#define RUN_CFG_NODE     (1 << 1)
+#define RUN_CFG_SETPOINT (1 << 2)
+#define RUN_CFG_FIXED    (1 << 3)
+#define RUN_CFG_COOLER   (1 << 4)
+
+#define RUN_CFG_NODE_MIN     1
+#define RUN_CFG_NODE_MAX     (DEVICES_CONNECT - 1)
+#define RUN_CFG_SETPOINT_MIN 5.0f
+#define RUN_CFG_SETPOINT_MAX 90.0f
+
+struct Run_config{
+      uint32_t version;             // 0 = valores de arranque
+      uint8_t mode;                 // RUN_MODE_*
+      uint8_t node;                 // 1..RUN_CFG_NODE_MAX
+      float setpoint;               // °C
+      uint8_t fixed_percent;        // 0..100
+      uint8_t cooler_percent;       // 0..100
+    };
+
+// Cambio pedido: sólo se aplican los campos marcados en fields. Los
+// valores van sin acotar para que validate() rechace los fuera de rango
+struct Run_config_patch{
+      uint8_t fields;               // RUN_CFG_*
+      int mode;
+      int node;
+      float setpoint;
+      int fixed_percent;
+      int cooler_percent;
+    };
+
+class API_RunConfig {
+public:
+    API_RunConfig(float setpoint, uint8_t fixed_percent, uint8_t cooler_percent);
+    Run_config get() const { return __published.read(); }
+    // Aplica el parche entero o nada. Devuelve NULL y la configuración
+    // publicada en out, o el mensaje de error sin tocar nada
+    const char* apply(const Run_config_patch& patch, Run_config* out = NULL);
+    static const char* validate(const Run_config_patch& patch);
+    // Documento JSON plano, completo o parcial:
+    //   {"mode":"pid","node":2,"setpoint":35.5,"fixed_percent":40,"cooler_percent":66}
+    // Claves desconocidas o valores mal formados son error
+    static const char* parse(const char* json, Run_config_patch& patch);
+
+private:
+    Run_config __current;           // copia del escritor
+    API_Snapshot<Run_config> __published;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef API_Sampler_h
+#define API_Sampler_h
+
+#include "Arduino.h"
+#include "API_Sensors.h"
+#include "API_Resistor.h"
+#include "API_Snapshot.h"
+
+// Tarea de muestreo: núcleo 0 (loop() de Arduino corre en el 1)
+#define SAMPLER_CORE        0
+#define SAMPLER_PRIORITY    1
+#define SAMPLER_STACK       4096
+// La tarea duerme hasta el próximo evento planificado por API_Sensors,
+// acotado para atender cambios de nodo/resolución
+#define SAMPLER_MAX_SLEEP_MS 100
+// Sensor junto a la resistencia: corrige su valor con la temperatura
+#define SAMPLER_HEATER_NODE  1
+
+// Conjunto de muestras publicado para HTTP y control
+struct Sample_snapshot{
+      Temp_raw temps_raw[DEVICES_CONNECT];  // 1/16 °C
+      float heater_w;
+      unsigned long timestamp_ms;   // millis() de la lectura de temperaturas
+      uint32_t seq;                 // 0 = todavía sin muestras
+      uint8_t resolution[DEVICES_CONNECT]; // bits vigentes de cada sensor
+      uint32_t bus_time_us;         // tiempo de bus 1-Wire de esta muestra
+      Sensor_health health[DEVICES_CONNECT];
+    };
+
+class API_Sampler {
+public:
+    API_Sampler();
+    // Toma posesión del bus de sensores y lanza la tarea de muestreo
+    bool begin(API_Sensors* sensors, API_Resistor* heater);
+    // Una iteración de la tarea; devuelve true si publicó un snapshot
+    bool step();
+    // Lectura en tiempo constante, sin tocar el hardware
+    Sample_snapshot snapshot() const { return __snapshot.read(); }
+
+private:
+    API_Sensors* __sensors;
+    API_Resistor* __heater;
+    API_Snapshot<Sample_snapshot> __snapshot;
+
+    static void task(void* arg);
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef API_SensorBus_h
+#define API_SensorBus_h
+
+#include "Arduino.h"
+
+// Backend de un bus 1-Wire de sensores DS18B20, elegido en compilación:
+//   SENSORS_BACKEND_DALLAS  -> OneWire + DallasTemperature (por defecto)
+//   SENSORS_BACKEND_DSTHERM -> OneWireNg + drivers/DSTherm
+// Ej.: build_flags = -DSENSORS_BACKEND=SENSORS_BACKEND_DSTHERM
+#define SENSORS_BACKEND_DALLAS   0
+#define SENSORS_BACKEND_DSTHERM  1
+#ifndef SENSORS_BACKEND
+#define SENSORS_BACKEND SENSORS_BACKEND_DALLAS
+#endif
+
+#include "OneWireNg_CurrentPlatform.h"
+#if SENSORS_BACKEND == SENSORS_BACKEND_DSTHERM
+#include "drivers/DSTherm.h"
+#else
+#include <DallasTemperature.h>
+#endif
+
+#define SENSORBUS_DISCONNECTED_C  -127
+#define SENSORBUS_FAMILY_DS18B20  0x28
+#define SENSORBUS_READ_SCRATCHPAD 0xBE
+#define SENSORBUS_WRITE_SCRATCHPAD 0x4E
+
+typedef uint8_t Sensor_rom[8];
+
+// Temperatura en el formato del DS18B20: int16 en 1/16 °C. Se mantiene así
+// desde el scratchpad hasta los serializadores; a °C sólo en la ley de
+// control y al formatear texto
+typedef int16_t Temp_raw;
+#define TEMP_RAW_ONE_C            16
+#define TEMP_RAW_POWER_ON         0x0550   // 85 °C de encendido
+#define SENSORBUS_DISCONNECTED_RAW ((Temp_raw)(SENSORBUS_DISCONNECTED_C * TEMP_RAW_ONE_C))
+
+inline float temp_raw_to_c(Temp_raw raw) { return raw / (float)TEMP_RAW_ONE_C; }
+inline Temp_raw temp_c_to_raw(float c) { return (Temp_raw)(c * TEMP_RAW_ONE_C + (c < 0 ? -0.5f : 0.5f)); }
+
+// Formatea con 2 decimales sin aritmética de punto flotante ("-12.34");
+// buf de al menos TEMP_RAW_TEXT_MAX bytes: todo el rango int16 llega a
+// "-2048.00" (9 con el NUL). Devuelve la longitud escrita
+#define TEMP_RAW_TEXT_MAX 10
+inline int temp_raw_format(char* buf, Temp_raw raw) {
+  int32_t centi = ((int32_t)raw * 100 + (raw < 0 ? -TEMP_RAW_ONE_C / 2 : TEMP_RAW_ONE_C / 2)) / TEMP_RAW_ONE_C;
+  int n = 0;
+  if (centi < 0) { buf[n++] = '-'; centi = -centi; }
+  int32_t whole = centi / 100;
+  char tmp[4];
+  int k = 0;
+  do { tmp[k++] = '0' + whole % 10; whole /= 10; } while (whole);
+  while (k) buf[n++] = tmp[--k];
+  buf[n++] = '.';
+  buf[n++] = '0' + (centi / 10) % 10;
+  buf[n++] = '0' + centi % 10;
+  buf[n] = 0;
+  return n;
+}
+
+// Resultado de una lectura completa del scratchpad
+enum Sensor_read {
+      SENSOR_READ_OK,
+      SENSOR_READ_DISCONNECTED,   // sin presencia, todo 0xff o todo ceros
+      SENSOR_READ_CRC_ERROR
+    };
+
+class API_SensorBus {
+public:
+    explicit API_SensorBus(uint8_t pin);
+    void begin();
+    // Búsqueda incremental del bus (una ROM por llamada)
+    void reset_search();
+    bool search(Sensor_rom rom);
+    // CRC8 de la ROM y familia de termómetro soportada
+    bool valid_rom(const Sensor_rom rom);
+    // Conversión sin esperar: todo el bus o un único sensor
+    void convert_all();
+    void convert(const Sensor_rom rom);
+    bool isConversionComplete();
+    uint16_t millisToWaitForConversion(uint8_t bits);
+    bool setResolution(const Sensor_rom rom, uint8_t bits);
+    // Umbrales de alarma TH/TL (°C enteros) conservando la resolución; no
+    // se copian a EEPROM
+    bool setAlarms(const Sensor_rom rom, int8_t th, int8_t tl, uint8_t bits);
+    // Búsqueda condicional: sólo sensores cuya última conversión quedó
+    // fuera de su ventana TH/TL
+    void reset_alarm_search();
+    bool alarm_search(Sensor_rom rom);
+    // Scratchpad completo (9 bytes) con CRC verificado; raw sólo se
+    // escribe con SENSOR_READ_OK
+    Sensor_read readTemp(const Sensor_rom rom, Temp_raw* raw);
+    // Lectura rápida: sólo los 2 bytes de temperatura y reset del bus, sin
+    // CRC. SENSORBUS_DISCONNECTED_RAW si no hay presencia o el bus no responde
+    Temp_raw readTempFast(const Sensor_rom rom, uint8_t bits);
+    // Tiempo acumulado ocupando el bus (us), para comparar backends
+    uint32_t bus_time_us() { return __bus_time_us; }
+
+private:
+#if SENSORS_BACKEND == SENSORS_BACKEND_DSTHERM
+    OneWireNg* __ow;
+    DSTherm* __drv;
+    bool __search_done;
+    bool searchNext(Sensor_rom rom, bool alarm);
+#else
+    OneWire* __oneWire;
+    DallasTemperature* __sensors;
+#endif
+    uint32_t __bus_time_us;
+};
+
+#endif
@@ -1,32 +1,258 @@
 #ifndef API_Sensors_h
 #define API_Sensors_h
- 
+
 #include "Arduino.h"
-#include "OneWireNg_CurrentPlatform.h"
-#include <DallasTemperature.h>
+#include "API_SensorBus.h"
+#include "API_Snapshot.h"
 
 
 #define ONE_WIRE_BUS    15
+// Sensores: 0 = ambiente, 1..DEVICES_CONNECT-1 = nodos de la barra. Las
+// máscaras de sensores son de 32 bits: hasta 31 (30 nodos), repartidos en
+// buses con SENSORS_BUS_COUNT. Ej.: -DDEVICES_CONNECT=17
+#ifndef DEVICES_CONNECT
 #define DEVICES_CONNECT 5
+#endif
+static_assert(DEVICES_CONNECT >= 2 && DEVICES_CONNECT <= 31, "DEVICES_CONNECT 2..31");
+
+// Buses 1-Wire independientes, uno por pin. Los índices de sensor se
+// asignan por bus (en el orden de la lista) y dentro de cada bus por
+// orden de búsqueda. Ej.: -DSENSORS_BUS_COUNT=2 -DSENSORS_BUS_PINS="{15,16}"
+#ifndef SENSORS_BUS_COUNT
+#define SENSORS_BUS_COUNT 1
+#endif
+#ifndef SENSORS_BUS_PINS
+#define SENSORS_BUS_PINS  { ONE_WIRE_BUS }
+#endif
+
+// Mapa ROM -> rol (0 = ambiente, 1.. = nodos) guardado en NVS: con mapa
+// el arranque no busca en el bus y el orden de los nodos no depende del
+// orden de búsqueda; la verificación corre luego desde poll()
+#define SENSORS_USE_NVS_MAP   true
+#define SENSORS_MAP_NAMESPACE "sensors"
+#define SENSORS_MAP_VERSION   1
+
+// Muestreo multi-tasa del modo asíncrono (poll):
+// nodo de control convertido solo y rápido, el resto a tasa lenta
+#define SENSORS_CONTROL_PERIOD 1000
+#define SENSORS_AUX_PERIOD     5000
+#define SENSORS_CONTROL_NODE   1
+
+// Resolución DS18B20 (9..12 bits): 12 bits = 750 ms, 9 bits = 94 ms.
+// El nodo de control baja a SENSORS_RES_TRANSIENT mientras |dT/dt| supera
+// SENSORS_TRANSIENT_RATE y vuelve a SENSORS_RES_DEFAULT en régimen
+#define SENSORS_RES_DEFAULT    12
+#define SENSORS_RES_TRANSIENT  10
+#define SENSORS_TRANSIENT_RATE 0.05 // °C/s
+#define SENSORS_ADAPTIVE_RES   true
+
+// Lectura rápida (2 bytes, sin CRC): una lectura completa con CRC cada
+// SENSORS_FULL_READ_EVERY muestras por sensor, o si el valor salta más de
+// SENSORS_FAST_MAX_JUMP respecto del último válido
+#define SENSORS_FAST_READ       true
+#define SENSORS_FULL_READ_EVERY 10
+#define SENSORS_FAST_MAX_JUMP   2.0 // °C
+
+// Salud por sensor: tras SENSORS_FAIL_THRESHOLD fallas seguidas el sensor
+// se saltea 1, 3, 7... ciclos de lectura (hasta SENSORS_BACKOFF_MAX) en
+// lugar de gastar tiempo de bus en cada ciclo
+#define SENSORS_MIN_VALID_C     5    // por debajo: lectura fuera de rango
+#define SENSORS_FAIL_THRESHOLD  2
+#define SENSORS_BACKOFF_MAX     31   // ciclos
+#define SENSORS_STUCK_READS     120  // lecturas idénticas seguidas = valor trabado
+
+// Modo monitoreo (reposo): TH/TL alrededor del grado entero de cada sensor
+// (ampliado SENSORS_MONITOR_MARGIN °C) y ALARM SEARCH tras cada conversión;
+// sólo se leen los sensores que se movieron. Cada SENSORS_MONITOR_REFRESH
+// ciclos se leen todos para no perder desconexiones
+#define SENSORS_MONITOR_MARGIN  0    // °C enteros
+#define SENSORS_MONITOR_REFRESH 12   // ciclos
+
+// Traza por sensor en getTemperatures() (ROM y temperatura de cada
+// lectura). Ej.: -DSENSORS_VERBOSE=true
+#ifndef SENSORS_VERBOSE
+#define SENSORS_VERBOSE false
+#endif
+
+struct Sensor_health{
+      uint16_t crc_errors;
+      uint16_t disconnects;
+      uint16_t power_on_resets;     // 85 °C de encendido con CRC válido
+      uint16_t out_of_range;
+      uint16_t stuck;               // rachas de SENSORS_STUCK_READS lecturas idénticas
+      uint8_t failures;             // fallas consecutivas (0 = sano)
+      uint8_t backoff;              // ciclos de lectura que faltan saltear
+      unsigned long last_good_ms;   // millis() de la última lectura válida (0 = nunca)
+    };
+
+// Último conjunto de muestras
+struct Sensors_sample{
+      Temp_raw temps_raw[DEVICES_CONNECT];  // 1/16 °C
+      unsigned long timestamp_ms;   // millis() al terminar la lectura
+      uint32_t seq;                 // 0 = todavía sin muestras
+      uint32_t updated_mask;        // bit i = sensor i leído en esta muestra
+      uint8_t resolution[DEVICES_CONNECT]; // bits vigentes de cada sensor
+      uint32_t bus_time_us;         // tiempo de bus (todos los buses) de esta muestra
+      Sensor_health health[DEVICES_CONNECT];
+    };
+
+// Mapa de roles publicado para otras tareas (HTTP): ROMs, buses y última
+// verificación de la misma versión, sin leer las tablas de poll()
+struct Sensors_map{
+      Sensor_rom rom[DEVICES_CONNECT];
+      int8_t bus[DEVICES_CONNECT];  // -1 = rol sin ROM
+      bool verified;
+      uint32_t missing;             // bit i = rol i no encontrado en el bus
+      uint8_t unknown_count;        // ROMs en el bus sin rol
+      Sensor_rom unknown[DEVICES_CONNECT];
+      uint8_t unknown_bus[DEVICES_CONNECT];
+    };
 
 class API_Sensors {
 public:
     API_Sensors();
     void init(bool print_init = false);
+    // Re-descubre los buses y reconstruye la tabla de ROMs; devuelve cantidad válida
+    int rescan(bool print_scan = false);
+    // Lecturas bloqueantes; convierten a °C a la salida
     void getTemperatures(float write_data[DEVICES_CONNECT]);
     float getTemperatureId(uint8_t id_sensor = 1);
-    
-private:    
-    OneWire* __oneWire;
-    DallasTemperature* __sensors;
-    DeviceAddress __tempDeviceAddress;
+    // Modo asíncrono: avanza la máquina de estados sin esperar al bus.
+    // Devuelve true cuando se publicó un nuevo conjunto en latest()
+    bool poll();
+    const Sensors_sample& latest() { return __latest; }
+    void set_control_node(uint8_t id_sensor) { __control_node = id_sensor; }
+    void set_control_period(unsigned long period_ms) { __control_period_ms = period_ms; }
+    void set_aux_period(unsigned long period_ms) { __aux_period_ms = period_ms; }
+    // Resolución por sensor; se escribe en el sensor desde poll() con el bus libre
+    bool set_resolution(uint8_t id_sensor, uint8_t bits);
+    uint8_t get_resolution(uint8_t id_sensor) { return __resolution[id_sensor]; }
+    // Política adaptativa del nodo de control (transitorio / régimen)
+    void set_adaptive_resolution(bool enable) { __adaptive_res = enable; }
+    void set_control_resolution(uint8_t transient_bits, uint8_t steady_bits, float transient_rate);
+    // Tiempo de conversión para una resolución dada
+    static uint16_t conversion_ms(uint8_t bits) {
+      return bits <= 9 ? 94 : bits == 10 ? 188 : bits == 11 ? 375 : 750;
+    }
+    // Lectura rápida de scratchpad con verificación completa periódica
+    void set_fast_read(bool enable, uint8_t full_every = SENSORS_FULL_READ_EVERY);
+    // Modo monitoreo por alarmas; se aplica en el próximo ciclo de poll()
+    void set_monitor_mode(bool enable) { __monitor_request = enable; }
+    bool get_monitor_mode() { return __monitor; }
+    // Milisegundos hasta el próximo evento planificado de poll()
+    unsigned long ms_to_next_event();
+    // Mapa de roles: reasignación y reconstrucción en orden de búsqueda se
+    // aplican desde poll() con el bus libre y se guardan en NVS
+    bool set_role(uint8_t role, const Sensor_rom rom);
+    void rebuild_map() { __remap_request = REMAP_REBUILD; }
+    bool remap_pending() { return __remap_request != REMAP_NONE; }
+    // Mapa publicado: desde cualquier tarea. Para varios campos juntos,
+    // una sola lectura de get_map()
+    Sensors_map get_map() const { return __map.read(); }
+    bool get_rom(uint8_t role, Sensor_rom rom);
+    // Resultado de la última verificación contra el bus
+    bool get_map_verified() const { return __map.read().verified; }
+    uint32_t get_map_missing() const { return __map.read().missing; }
+    int get_unknown_count() const { return __map.read().unknown_count; }
+    bool get_unknown(int k, Sensor_rom rom, int* bus);
+    int get_device_count() { return __numberOfDevices; }
+    int get_bus_of(uint8_t id_sensor) { return id_sensor < DEVICES_CONNECT ? __map.read().bus[id_sensor] : -1; }
+    const Sensor_health& get_health(uint8_t id_sensor) { return __health[id_sensor]; }
+
+private:
+    API_SensorBus* __bus[SENSORS_BUS_COUNT];
     int __numberOfDevices;
-    
+
+    // Tabla de ROMs descubierta en init()/rescan(): índice = bus y orden de búsqueda
+    Sensor_rom __rom_table[DEVICES_CONNECT];
+    uint8_t __rom_bus[DEVICES_CONNECT];
+    bool __rom_valid[DEVICES_CONNECT];
+    uint32_t __bus_devices[SENSORS_BUS_COUNT];  // máscara de sensores de cada bus
+    // Orden de lectura intercalado entre buses (uno de cada bus por vuelta)
+    uint8_t __read_order[DEVICES_CONNECT];
+
+    // Verificación del mapa: roles no encontrados y ROMs sin rol
+    bool __verify_pending;
+    bool __map_verified;
+    uint32_t __map_missing;
+    Sensor_rom __unknown[DEVICES_CONNECT];
+    uint8_t __unknown_bus[DEVICES_CONNECT];
+    int __unknown_count;
+    API_Snapshot<Sensors_map> __map;
+    enum Remap_request { REMAP_NONE, REMAP_ROLE, REMAP_REBUILD };
+    volatile uint8_t __remap_request;
+    uint8_t __remap_role;
+    Sensor_rom __remap_rom;
+
     // 5 sensores: 1 ambiente + 4 de la barra
-    float __temperature_data[DEVICES_CONNECT];
+    Temp_raw __temperature_data[DEVICES_CONNECT];
+
+    // Lecturas rápidas desde la última completa, por sensor
+    volatile bool __fast_read;
+    uint8_t __full_every;
+    uint8_t __fast_count[DEVICES_CONNECT];
+
+    // Salud y lecturas idénticas seguidas, por sensor
+    Sensor_health __health[DEVICES_CONNECT];
+    uint16_t __same_count[DEVICES_CONNECT];
 
+    // Modo monitoreo: umbrales programados por sensor
+    volatile bool __monitor_request;
+    bool __monitor;
+    bool __alarm_set[DEVICES_CONNECT];
+    uint8_t __monitor_cycles;
 
-    void printAddress(DeviceAddress deviceAddress);    
+    // Máquina de estados de adquisición
+    enum Acq_state { ACQ_IDLE, ACQ_CONVERTING };
+    Acq_state __acq_state;
+    uint32_t __acq_mask;            // sensores incluidos en la conversión en curso
+    uint32_t __acq_read;            // sensores efectivamente leídos
+    uint32_t __acq_pending;         // bit b = bus b todavía convirtiendo
+    unsigned long __acq_start_ms;
+    uint32_t __acq_bus_us;          // tiempo de bus acumulado al iniciar la conversión
+    unsigned long __acq_wait_ms[SENSORS_BUS_COUNT];  // duración planificada por bus
+    unsigned long __control_start_ms;
+    unsigned long __aux_start_ms;
+    unsigned long __control_period_ms;
+    unsigned long __aux_period_ms;
+    volatile uint8_t __control_node;
+    Sensors_sample __latest;
+
+    // Resolución aplicada y pedida por sensor
+    uint8_t __resolution[DEVICES_CONNECT];
+    volatile uint8_t __resolution_target[DEVICES_CONNECT];
+    volatile bool __adaptive_res;
+    uint8_t __res_transient;
+    uint8_t __res_steady;
+    float __transient_rate;
+    bool __in_transient;
+    uint8_t __control_prev_node;
+    Temp_raw __control_prev_temp;
+    unsigned long __control_prev_ms;
+
+    void startConversion(uint32_t mask);
+    bool busDone(int bus, unsigned long elapsed);
+    void waitConversion();
+    void readSensors(uint32_t mask, bool verbose);
+    bool readSensor(int id_sensor, Temp_raw* raw);
+    void readFailed(int id_sensor);
+    uint32_t alarmedSensors(uint32_t buses, uint32_t mask);
+    void armAlarms(uint32_t mask);
+    void publish(uint32_t mask);
+    void applyResolutions();
+    void updateTransient();
+    unsigned long planConversion(int bus, uint32_t mask);
+    uint32_t busTimeUs();
+
+    void indexTable();
+    int findRole(const Sensor_rom rom);
+    bool loadMap();
+    bool saveMap();
+    bool verifyMap();
+    void applyRemap();
+    void publishMap();
+
+    void printAddress(const uint8_t* deviceAddress);
 };
- 
-#endif
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef API_Snapshot_h
+#define API_Snapshot_h
+
+#include <atomic>
+
+// Publicación de un valor entre tareas/núcleos sin locks (seqlock).
+// Un único escritor; lectores en tiempo constante, reintentan sólo si
+// leyeron durante una escritura (seq impar o cambiado).
+template <typename T>
+class API_Snapshot {
+public:
+    API_Snapshot() : __seq(0), __data() {}
+
+    void publish(const T& value) {
+      uint32_t s = __seq.load(std::memory_order_relaxed);
+      __seq.store(s + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      __data = value;
+      std::atomic_thread_fence(std::memory_order_release);
+      __seq.store(s + 2, std::memory_order_release);
+    }
+
+    T read() const {
+      T out;
+      uint32_t s1, s2;
+      do {
+        s1 = __seq.load(std::memory_order_acquire);
+        out = __data;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s2 = __seq.load(std::memory_order_relaxed);
+      } while ((s1 & 1) || s1 != s2);
+      return out;
+    }
+
+    // Cantidad de publicaciones realizadas
+    uint32_t version() const { return __seq.load(std::memory_order_acquire) >> 1; }
+
+private:
+    std::atomic<uint32_t> __seq;
+    T __data;
+};
+
+#endif
@@ -62,24 +62,22 @@ modeEl.addEventListener('change', updateModeVisibility);
 updateModeVisibility();
 
 document.getElementById('applyConfig').addEventListener('click', async () => {
+  // Un solo POST: el backend valida todo y aplica una única versión
   const mode = modeEl.value;
-  const cooler = Number(coolerPercentEl.value);
-  const actions = [];
+  const config = { mode, cooler_percent: Number(coolerPercentEl.value) };
+  if (mode === 'pid') {
+    config.node = Number(nodeEl.value);
+    config.setpoint = Number(Number(targetTempEl.value).toFixed(1));
+  } else {
+    config.fixed_percent = Number(pwmPercentEl.value);
+  }
   try {
-    actions.push(fetchJSON(`/api/cooler?percent=${cooler}`, { method: 'POST' }));
-    if (mode === 'pid') {
-      const node = Number(nodeEl.value);
-      const targetTemp = Number(targetTempEl.value);
-      actions.push(fetchJSON(`/api/mode?type=pid`, { method: 'POST' }));
-      actions.push(fetchJSON(`/api/node?index=${node}`, { method: 'POST' }));
-      actions.push(fetchJSON(`/api/setpoint?temp=${targetTemp.toFixed(1)}`, { method: 'POST' }));
-    } else {
-      const pwmPercent = Number(pwmPercentEl.value);
-      actions.push(fetchJSON(`/api/mode?type=fixed`, { method: 'POST' }));
-      actions.push(fetchJSON(`/api/fixed?percent=${pwmPercent}`, { method: 'POST' }));
-    }
-    const results = await Promise.all(actions);
-    setPre('configResult', { ok: true, results });
+    const res = await fetchJSON('/api/config', {
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json' },
+      body: JSON.stringify(config)
+    });
+    setPre('configResult', res);
   } catch (e) {
     setPre('configResult', { error: String(e) });
   }
@@ -203,40 +201,66 @@ function drawChart() {
   ctx.stroke();
 }
 
+function applyState(s) {
+  const temps = s.temperatures ? s.temperatures.nodes : [];
+  const ambient = s.temperatures ? s.temperatures.room : undefined;
+  const control_pct = typeof s.control_pct === 'number' ? s.control_pct : (s.mode === 'pid' ? undefined : s.fixed_percent);
+  // Actualiza panel de sensores (texto) además del gráfico
+  setPre('sensors', {
+    running: s.running,
+    mode: s.mode,
+    node: s.node,
+    setpoint: s.setpoint,
+    cooler_percent: s.cooler_percent,
+    fixed_percent: s.fixed_percent,
+    room: ambient,
+    nodes: temps,
+    control_pct
+  });
+  history.push({ t: Date.now(), temps, ambient, control_pct });
+  if (history.length > MAX_POINTS) history.shift();
+  drawChart();
+}
+
 async function pollSensorsOnce() {
   try {
-    const s = await fetchJSON('/api/state');
-    const temps = s.temperatures ? s.temperatures.nodes : [];
-    const ambient = s.temperatures ? s.temperatures.room : undefined;
-    const control_pct = typeof s.control_pct === 'number' ? s.control_pct : (s.mode === 'pid' ? undefined : s.fixed_percent);
-    // Actualiza panel de sensores (texto) además del gráfico
-    setPre('sensors', {
-      running: s.running,
-      mode: s.mode,
-      node: s.node,
-      setpoint: s.setpoint,
-      cooler_percent: s.cooler_percent,
-      fixed_percent: s.fixed_percent,
-      room: ambient,
-      nodes: temps,
-      control_pct
-    });
-    history.push({ t: Date.now(), temps, ambient, control_pct });
-    if (history.length > MAX_POINTS) history.shift();
-    drawChart();
+    applyState(await fetchJSON('/api/state'));
   } catch (e) {
     console.error('Error al consultar /api/state:', e);
   }
 }
 
+// Autorefresco: /api/stream (SSE, un frame por muestra). Si el backend no
+// lo ofrece o se cae antes del primer frame, se vuelve al sondeo periódico
 let timer = null;
+let stream = null;
+function stopRefresh() {
+  if (timer) { clearInterval(timer); timer = null; }
+  if (stream) { stream.close(); stream = null; }
+}
+function startPolling() {
+  const period = Math.max(200, Number(document.getElementById('period').value)||1000);
+  timer = setInterval(pollSensorsOnce, period);
+}
 function updateTimer() {
   const enabled = document.getElementById('autorefresh').checked;
-  const period = Math.max(200, Number(document.getElementById('period').value)||1000);
-  if (timer) clearInterval(timer);
-  if (enabled) {
-    timer = setInterval(pollSensorsOnce, period);
-  }
+  stopRefresh();
+  if (!enabled) return;
+  if (typeof EventSource === 'undefined') { startPolling(); return; }
+  let gotFrame = false;
+  const es = new EventSource('/api/stream');
+  es.onmessage = (ev) => {
+    gotFrame = true;
+    try { applyState(JSON.parse(ev.data)); }
+    catch (e) { console.error('Frame inválido de /api/stream:', e); }
+  };
+  es.onerror = () => {
+    // Con frames previos EventSource reconecta solo; sin ninguno, sondeo
+    if (gotFrame || stream !== es) return;
+    stopRefresh();
+    startPolling();
+  };
+  stream = es;
 }
 document.getElementById('autorefresh').addEventListener('change', updateTimer);
 document.getElementById('period').addEventListener('change', updateTimer);
@@ -0,0 +1,80 @@
+#include "API_Actuator.h"
+
+API_Actuator::API_Actuator(int pin, int channel, uint32_t freq, uint8_t bits, bool dither)
+    : __pwm(pin, channel, freq, bits, dither) {
+    __target = 0;
+    __output = 0;
+    __ramp_up = 0;
+    __ramp_down = 0;
+    __pending = false;
+    __request_us = 0;
+    __update_us = 0;
+    __updated = false;
+    __stats = Actuator_stats();
+    API_Actuator::publish();
+}
+
+bool API_Actuator::begin(){
+    return __pwm.begin();
+}
+
+void API_Actuator::set(float percent){
+    if (!(percent > 0)) percent = 0;   // también NaN
+    if (percent > 100) percent = 100;
+    __stats.requests++;
+    if (percent != __target) {
+        __stats.changes++;
+        __request_us = micros();
+        __pending = true;
+        __target = percent;
+        if (!API_Actuator::ramped()) API_Actuator::apply(percent);
+    }
+    API_Actuator::publish();
+}
+
+void API_Actuator::set_ramp(float up_pct_s, float down_pct_s){
+    __ramp_up = up_pct_s > 0 ? up_pct_s : 0;
+    __ramp_down = down_pct_s > 0 ? down_pct_s : 0;
+}
+
+void API_Actuator::update(){
+    unsigned long now = micros();
+    float dt_s = __updated ? (now - __update_us) / 1e6f : 0.0f;
+    __update_us = now;
+    __updated = true;
+
+    float target = __target;
+    float out = __output;
+    if (out != target && API_Actuator::ramped()) {
+        float limit = target > out ? __ramp_up : __ramp_down;
+        if (limit > 0) {
+            float step = limit * dt_s;
+            out = target > out ? (out + step < target ? out + step : target)
+                               : (out - step > target ? out - step : target);
+        } else {
+            out = target;
+        }
+        API_Actuator::apply(out);
+    }
+    if (__pwm.update()) __stats.writes++;
+    API_Actuator::publish();
+}
+
+void API_Actuator::apply(float percent){
+    __output = percent;
+    if (__pwm.write(percent)) __stats.writes++;
+    if (__pending) {
+        __pending = false;
+        uint32_t lat = micros() - __request_us;
+        __stats.last_latency_us = lat;
+        if (lat > __stats.max_latency_us) __stats.max_latency_us = lat;
+    }
+}
+
+void API_Actuator::publish(){
+    Actuator_status st;
+    st.target = __target;
+    st.output = __output;
+    st.stats = __stats;
+    __status.publish(st);
+}
@@ -0,0 +1,93 @@
+#include "API_ControlLoop.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+API_ControlLoop::API_ControlLoop() {
+  __step = nullptr;
+  __arg = nullptr;
+  __period_us = CONTROL_PERIOD_US;
+  __timer = nullptr;
+  __task = nullptr;
+  __started = false;
+  __due_us = 0;
+  __last_us = 0;
+  __stats = Control_stats();
+}
+
+bool API_ControlLoop::begin(Control_step_fn step, void* arg, uint32_t period_us) {
+  __step = step;
+  __arg = arg;
+  __period_us = period_us;
+  TaskHandle_t handle = nullptr;
+  BaseType_t ok = xTaskCreatePinnedToCore(API_ControlLoop::task, "control", CONTROL_STACK,
+                                          this, CONTROL_PRIORITY, &handle, CONTROL_CORE);
+  if (ok != pdPASS) {
+    Serial.println("[Control] No se pudo crear la tarea de control");
+    return false;
+  }
+  __task = handle;
+
+  esp_timer_create_args_t args = {};
+  args.callback = API_ControlLoop::onTimer;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "control";
+  esp_timer_handle_t timer = nullptr;
+  if (esp_timer_create(&args, &timer) != ESP_OK || esp_timer_start_periodic(timer, __period_us) != ESP_OK) {
+    Serial.println("[Control] No se pudo iniciar el timer de control");
+    return false;
+  }
+  __timer = timer;
+  return true;
+}
+
+void API_ControlLoop::onTimer(void* arg) {
+  // Contexto del esp_timer: sólo despertar a la tarea
+  API_ControlLoop* self = static_cast<API_ControlLoop*>(arg);
+  if (self->__task) xTaskNotifyGive((TaskHandle_t)self->__task);
+}
+
+void API_ControlLoop::task(void* arg) {
+  API_ControlLoop* self = static_cast<API_ControlLoop*>(arg);
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->run_step(esp_timer_get_time());
+  }
+}
+
+void API_ControlLoop::run_step(int64_t now_us) {
+  // Primer paso: fija la grilla de ticks, dt nominal
+  if (!__started) {
+    __started = true;
+    __due_us = now_us;
+    __last_us = now_us - __period_us;
+  }
+  // Ticks enteros perdidos (tarea bloqueada más de un periodo): se cuentan
+  // y la grilla avanza hasta el tick vigente
+  while (now_us - __due_us >= (int64_t)__period_us) {
+    __due_us += __period_us;
+    __stats.misses++;
+  }
+
+  float dt_s = (now_us - __last_us) / 1e6f;
+  __last_us = now_us;
+  int32_t jitter = (int32_t)(now_us - __due_us);
+  if (__step) __step(dt_s, __arg);
+  int64_t end_us = esp_timer_get_time();
+
+  uint32_t exec = (uint32_t)(end_us - now_us);
+  uint32_t late = jitter < 0 ? (uint32_t)-jitter : (uint32_t)jitter;
+  int bin = 0;
+  while (bin < CONTROL_JITTER_BINS - 1 && late >= bin_limit_us(bin)) bin++;
+  __stats.jitter_hist[bin]++;
+  __stats.steps++;
+  if (end_us - __due_us > (int64_t)CONTROL_DEADLINE_US) __stats.misses++;
+  __stats.last_jitter_us = jitter;
+  if (late > __stats.max_jitter_us) __stats.max_jitter_us = late;
+  __stats.last_exec_us = exec;
+  if (exec > __stats.max_exec_us) __stats.max_exec_us = exec;
+  __stats.last_dt_s = dt_s;
+  __due_us += __period_us;
+  __published.publish(__stats);
+}
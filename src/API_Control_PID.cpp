@@ -18,30 +18,26 @@ void API_Control_PID::init() {
   PID_data.u_max = 0;  
   PID_data.u_min = 0;
 
+  __coefs = Pid_math<float>::coefs(0, 0, 0, 0, 0, 0);
   isConfigure = false;
 }
 
 void API_Control_PID::configure(PID_config PID_data_in){
   PID_data = PID_data_in;
+  __coefs = Pid_math<float>::coefs(PID_data.KP, PID_data.KI, PID_data.Ts, PID_data.Kb, PID_data.u_max, PID_data.u_min);
   isConfigure = true;  
 }
 
 float API_Control_PID::update(float data_in){
   PID_data.y = data_in;
-
-  // actualiza salida
-  PID_data.u = PID_data.KP * ( PID_data.Kb * PID_data.y_ref - PID_data.y) + PID_data.t_integ;
-
-  // saturacion de salida
-  if (PID_data.u > PID_data.u_max) {
-    PID_data.u = PID_data.u_max;
-    } else if (PID_data.u < PID_data.u_min) {
-    PID_data.u = PID_data.u_min;
-  }
-
-  // actualiza proximo termino integrador
-  PID_data.t_integ += PID_data.KI * PID_data.Ts * ( PID_data.y_ref - PID_data.y);
-  
+  // actualiza salida saturada y proximo termino integrador
+  PID_data.u = Pid_math<float>::step(__coefs, PID_data.t_integ, PID_data.y_ref, data_in);
   return PID_data.u;
 }
 
+float API_Control_PID::update(float data_in, float dt_s){
+  PID_data.y = data_in;
+  float ratio = PID_data.Ts > 0 ? dt_s / PID_data.Ts : 1.0f;
+  PID_data.u = Pid_math<float>::step(__coefs, PID_data.t_integ, PID_data.y_ref, data_in, ratio);
+  return PID_data.u;
+}
@@ -1,22 +1,32 @@
 #include "API_HttpServer.h"
 
 #include <WiFi.h>
-#include <WebServer.h>
 #include <ctype.h>
+#include <errno.h>
+#include <lwip/sockets.h>
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+#include <esp_http_server.h>
+#else
+#include <WebServer.h>
+#endif
 
 #include "API_Sensors.h"
 #include "API_Resistor.h"
+#include "API_Sampler.h"
+#include "API_Actuator.h"
+#include "API_ControlLoop.h"
+#include "API_JsonWriter.h"
+#include "API_RunConfig.h"
 
 // Usa objetos globales
 extern API_Sensors Temperature;
 extern API_Resistor Qin;
+extern API_Sampler Sampler;
+extern API_Actuator Cooler;
+extern API_ControlLoop Control;
 // Estado de control (definido en main.cpp)
 extern volatile bool  g_running;
-extern volatile int   g_mode;      // 0 fijo, 1 pid
-extern volatile int   g_selectedNode; // 1..4
-extern volatile float g_setpoint;  // °C
-extern volatile int   g_fixedPercent; // 0..100
-extern volatile int   g_coolerPercent; // 0..100
+extern API_RunConfig RunConfig;  // modo, nodo, setpoint y porcentajes
 
 // Config STA/AP por defecto (puedes cambiarlos por build_flags)
 #ifndef WIFI_STA_SSID
@@ -34,64 +44,464 @@ extern volatile int   g_coolerPercent; // 0..100
 #define WIFI_AP_PASS "12345678"
 #endif
 
+// Contexto de un pedido, común a los dos backends: los handlers leen
+// argumentos y responden sólo a través de req*(), nunca del servidor
+#define HTTP_MAX_RESP_HEADERS 8
+struct Http_req {
+      char* buf;                    // búfer JSON de la respuesta
+      size_t cap;
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+      httpd_req_t* raw;
+      char query[HTTP_QUERY_MAX];
+      char body[HTTP_BODY_MAX + 1];
+      bool form;                    // cuerpo x-www-form-urlencoded
+      char status[32];
+      const char* hdr_name[HTTP_MAX_RESP_HEADERS];
+      const char* hdr_value[HTTP_MAX_RESP_HEADERS];
+      int hdrs;
+#endif
+    };
+typedef void (*Http_handler)(Http_req& r);
+
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+static_assert(HTTP_MAX_CONNECTIONS <= CONFIG_LWIP_MAX_SOCKETS - 3, "HTTP_MAX_CONNECTIONS > sockets de lwip");
+#endif
+// esp_http_server: tarea propia, un pedido a la vez por tarea pero muchas
+// conexiones keep-alive abiertas; el búfer JSON vive en la pila del pedido
+static httpd_handle_t httpd = NULL;
+
+static bool reqHasArg(Http_req& r, const char* name) {
+  char v[2];
+  if (!strcmp(name, "plain")) return r.body[0] != '\0';
+  // ESP_ERR_HTTPD_RESULT_TRUNC también indica que la clave existe
+  esp_err_t e = httpd_query_key_value(r.query, name, v, sizeof(v));
+  if (e == ESP_OK || e == ESP_ERR_HTTPD_RESULT_TRUNC) return true;
+  if (!r.form) return false;
+  e = httpd_query_key_value(r.body, name, v, sizeof(v));
+  return e == ESP_OK || e == ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+static String reqArg(Http_req& r, const char* name) {
+  // Sin decodificar %xx: los argumentos de la API son números y hex
+  char v[HTTP_ARG_MAX];
+  if (!strcmp(name, "plain")) return String(r.body);
+  if (httpd_query_key_value(r.query, name, v, sizeof(v)) == ESP_OK) return String(v);
+  if (r.form && httpd_query_key_value(r.body, name, v, sizeof(v)) == ESP_OK) return String(v);
+  return String();
+}
+static String reqHeader(Http_req& r, const char* name) {
+  char v[HTTP_ARG_MAX];
+  if (httpd_req_get_hdr_value_str(r.raw, name, v, sizeof(v)) != ESP_OK) return String();
+  return String(v);
+}
+// value debe seguir vivo hasta reqSend (literal o variable del handler)
+static void reqSetHeader(Http_req& r, const char* name, const char* value) {
+  if (r.hdrs >= HTTP_MAX_RESP_HEADERS) return;
+  r.hdr_name[r.hdrs] = name;
+  r.hdr_value[r.hdrs] = value;
+  r.hdrs++;
+}
+static const char* statusText(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 503: return "Service Unavailable";
+    default:  return "Internal Server Error";
+  }
+}
+static void reqSend(Http_req& r, int code, const char* type, const char* body, size_t len) {
+  snprintf(r.status, sizeof(r.status), "%d %s", code, statusText(code));
+  httpd_resp_set_status(r.raw, r.status);
+  httpd_resp_set_type(r.raw, type);
+  for (int i=0;i<r.hdrs;i++) httpd_resp_set_hdr(r.raw, r.hdr_name[i], r.hdr_value[i]);
+  httpd_resp_send(r.raw, body, len);
+}
+#else
+// WebServer de Arduino: atendido desde loop(), un pedido a la vez, así que
+// alcanza con un único búfer JSON estático
 static WebServer server(80);
+static char jsonBuf[HTTP_JSON_BUF];
 
-static void sendJson(const String& body, int code = 200) {
-  server.sendHeader("Access-Control-Allow-Origin", "*");
-  server.sendHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-  server.sendHeader("Access-Control-Allow-Headers", "Content-Type");
-  server.send(code, "application/json", body);
+static bool reqHasArg(Http_req&, const char* name) { return server.hasArg(name); }
+static String reqArg(Http_req&, const char* name) { return server.arg(name); }
+static String reqHeader(Http_req&, const char* name) { return server.header(name); }
+static void reqSetHeader(Http_req&, const char* name, const char* value) { server.sendHeader(name, value); }
+static void reqSend(Http_req&, int code, const char* type, const char* body, size_t len) {
+  server.send_P(code, type, body, len);
 }
+#endif
 
-static void handleHealth() {
-  sendJson("{\"status\":\"ok\"}");
+// Respuestas JSON escritas con API_JsonWriter sobre el búfer del pedido y
+// enviadas sin copiarlas a un String
+static void sendHeaders(Http_req& r) {
+  reqSetHeader(r, "Access-Control-Allow-Origin", "*");
+  reqSetHeader(r, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+  reqSetHeader(r, "Access-Control-Allow-Headers", "Content-Type, If-None-Match");
+  reqSetHeader(r, "Access-Control-Expose-Headers", "ETag");
+}
+static void sendJson(Http_req& r, const char* body, int code = 200) {
+  sendHeaders(r);
+  reqSend(r, code, "application/json", body, strlen(body));
+}
+static void sendJson(Http_req& r, const API_JsonWriter& w, int code = 200) {
+  if (!w.ok()) { sendJson(r, "{\"error\":\"response too large\"}", 500); return; }
+  sendHeaders(r);
+  reqSend(r, code, "application/json", w.c_str(), w.length());
+}
+
+// Versión del snapshot: seq, instante de la muestra y antigüedad al servir
+// (age_ms cambia en cada pedido: fuera de las respuestas con ETag)
+static void writeSnapshotVersion(API_JsonWriter& w, const Sample_snapshot& snap, bool with_age = true) {
+  w.field("seq", snap.seq);
+  w.field("timestamp_ms", snap.timestamp_ms);
+  if (!with_age) return;
+  w.key("age_ms");
+  if (snap.seq) w.value(millis() - snap.timestamp_ms); else w.value(-1);
+}
+
+static void handleHealth(Http_req& r) {
+  sendJson(r, "{\"status\":\"ok\"}");
 }
 
 // Endpoints de control
-static void handleRunStart() { g_running = true; Serial.println("[API] RUN iniciado"); sendJson("{\"ok\":true}"); }
-static void handleRunStop()  { g_running = false; Qin.set_pwm(0); Serial.println("[API] RUN detenido"); sendJson("{\"ok\":true}"); }
-static void handleMode() {
-  String t = server.arg("type");
-  if (t == "pid") g_mode = 1; else g_mode = 0;
-  Serial.println(String("[API] mode=") + (g_mode?"pid":"fixed"));
-  sendJson("{\"ok\":true}");
-}
-static void handleNode() {
-  int idx = server.arg("index").toInt();
-  if (idx>=1 && idx<=4) { g_selectedNode = idx; Serial.println(String("[API] node=") + idx); sendJson("{\"ok\":true}"); }
-  else sendJson("{\"error\":\"index 1-4\"}", 400);
-}
-static void handleSetpoint() {
-  float sp = server.arg("temp").toFloat();
-  if (sp>=5 && sp<=90) { g_setpoint = sp; Serial.println(String("[API] setpoint=") + String(sp,1)); sendJson("{\"ok\":true}"); }
-  else sendJson("{\"error\":\"temp 5-90C\"}", 400);
-}
-static void handleFixed() {
-  int p = server.arg("percent").toInt();
-  if (p>=0 && p<=100) { g_fixedPercent = p; Serial.println(String("[API] fixed%=") + p); sendJson("{\"ok\":true}"); }
-  else sendJson("{\"error\":\"percent 0-100\"}", 400);
-}
-static void handleCooler() {
-  int p = server.arg("percent").toInt();
-  if (p>=0 && p<=100) { g_coolerPercent = p; Serial.println(String("[API] cooler%=") + p); sendJson("{\"ok\":true}"); }
-  else sendJson("{\"error\":\"percent 0-100\"}", 400);
-}
-static void handleState() {
-  float temps[DEVICES_CONNECT] = {0};
-  Temperature.getTemperatures(temps);
-  String json = "{";
-  json += "\"running\":"; json += (g_running?"true":"false"); json += ",";
-  json += "\"mode\":\""; json += (g_mode?"pid":"fixed"); json += "\",";
-  json += "\"node\":"; json += g_selectedNode; json += ",";
-  json += "\"setpoint\":"; json += String(g_setpoint,1); json += ",";
-  json += "\"fixed_percent\":"; json += g_fixedPercent; json += ",";
-  json += "\"cooler_percent\":"; json += g_coolerPercent; json += ",";
-  json += "\"temperatures\":{\"room\":"; json += String(temps[0],2); json += ",\"nodes\":[";
-  for (int i=1;i<=4;i++){ if(i>1) json+=","; json+=String(temps[i],2);} json += "]},";
-  json += "\"heater_w\":"; json += String(Qin.get_heat(),3);
-  json += ",\"control_pct\":"; json += Qin.get_set_pwm_percent();
-  json += "}";
-  sendJson(json);
+static void handleRunStart(Http_req& r) { g_running = true; Serial.println("[API] RUN iniciado"); sendJson(r, "{\"ok\":true}"); }
+static void handleRunStop(Http_req& r)  { g_running = false; Qin.set_pwm(0); Serial.println("[API] RUN detenido"); sendJson(r, "{\"ok\":true}"); }
+// Configuración: todo cambio (rutas de un campo, shims y /api/config) es
+// una versión nueva completa de RunConfig. Devuelve NULL o el error
+static const char* applyConfig(const Run_config_patch& patch, Run_config* out = NULL) {
+  Run_config cfg;
+  const char* err = RunConfig.apply(patch, &cfg);
+  if (err) return err;
+  Serial.printf("[API] config v%lu mode=%s node=%d sp=%.1f fixed%%=%d cooler%%=%d\n",
+                (unsigned long)cfg.version, cfg.mode == RUN_MODE_PID ? "pid" : "fixed", cfg.node,
+                cfg.setpoint, cfg.fixed_percent, cfg.cooler_percent);
+  if (out) *out = cfg;
+  return NULL;
+}
+static void writeConfig(API_JsonWriter& w, const Run_config& cfg) {
+  w.begin_object();
+  w.field("version", cfg.version);
+  w.field("mode", cfg.mode == RUN_MODE_PID ? "pid" : "fixed");
+  w.field("node", (int)cfg.node);
+  w.field("setpoint", cfg.setpoint, 1);
+  w.field("fixed_percent", (int)cfg.fixed_percent);
+  w.field("cooler_percent", (int)cfg.cooler_percent);
+  w.end_object();
+}
+static void handleMode(Http_req& r) {
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_MODE;
+  patch.mode = reqArg(r, "type") == "pid" ? RUN_MODE_PID : RUN_MODE_FIXED;
+  applyConfig(patch);
+  sendJson(r, "{\"ok\":true}");
+}
+static void handleNode(Http_req& r) {
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_NODE;
+  patch.node = reqArg(r, "index").toInt();
+  if (applyConfig(patch)) sendJson(r, "{\"error\":\"index out of range\"}", 400);
+  else sendJson(r, "{\"ok\":true}");
+}
+static void handleSetpoint(Http_req& r) {
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_SETPOINT;
+  patch.setpoint = reqArg(r, "temp").toFloat();
+  if (applyConfig(patch)) sendJson(r, "{\"error\":\"temp 5-90C\"}", 400);
+  else sendJson(r, "{\"ok\":true}");
+}
+static void handleFixed(Http_req& r) {
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_FIXED;
+  patch.fixed_percent = reqArg(r, "percent").toInt();
+  if (applyConfig(patch)) sendJson(r, "{\"error\":\"percent 0-100\"}", 400);
+  else sendJson(r, "{\"ok\":true}");
+}
+// GET: configuración vigente. POST: documento JSON completo o parcial,
+// validado entero y aplicado en una sola versión; responde la nueva
+static void handleConfig(Http_req& r) {
+  Run_config cfg = RunConfig.get();
+  if (reqHasArg(r, "plain")) {
+    Run_config_patch patch;
+    String body = reqArg(r, "plain");
+    const char* err = API_RunConfig::parse(body.c_str(), patch);
+    if (!err) err = applyConfig(patch, &cfg);
+    if (err) {
+      API_JsonWriter w(r.buf, r.cap);
+      w.begin_object();
+      w.field("error", err);
+      w.field("version", RunConfig.get().version);
+      w.end_object();
+      sendJson(r, w, 400);
+      return;
+    }
+  }
+  API_JsonWriter w(r.buf, r.cap);
+  w.begin_object();
+  w.field("ok", true);
+  w.field("version", cfg.version);
+  w.key("config"); writeConfig(w, cfg);
+  w.end_object();
+  sendJson(r, w);
+}
+static void handleResolution(Http_req& r) {
+  // Resolución por sensor (0 = ambiente, 1.. = nodos); adaptive opcional
+  if (reqHasArg(r, "adaptive")) Temperature.set_adaptive_resolution(reqArg(r, "adaptive").toInt() != 0);
+  if (!reqHasArg(r, "index")) { sendJson(r, "{\"ok\":true}"); return; }
+  // Rango sobre el int antes de pasar a uint8_t (256 no debe ser 0)
+  int idx = reqArg(r, "index").toInt();
+  int bits = reqArg(r, "bits").toInt();
+  bool in_range = idx >= 0 && idx < DEVICES_CONNECT && bits >= 9 && bits <= 12;
+  if (in_range && Temperature.set_resolution(idx, bits)) { Serial.println(String("[API] res[") + idx + "]=" + bits); sendJson(r, "{\"ok\":true}"); }
+  else sendJson(r, "{\"error\":\"index out of range, bits 9-12\"}", 400);
+}
+static void writeActuator(API_JsonWriter& w, float output, const Actuator_stats& st) {
+  w.begin_object();
+  w.field("output", output, 2);
+  w.field("requests", st.requests);
+  w.field("changes", st.changes);
+  w.field("writes", st.writes);
+  w.field("last_latency_us", st.last_latency_us);
+  w.field("max_latency_us", st.max_latency_us);
+  w.end_object();
+}
+// ROM en 16 dígitos hex, MSB del primer byte primero (como printAddress)
+static void romToHex(const Sensor_rom rom, char out[17]) {
+  static const char* hex = "0123456789ABCDEF";
+  for (int i=0;i<8;i++){ out[2*i] = hex[rom[i] >> 4]; out[2*i+1] = hex[rom[i] & 0x0F]; }
+  out[16] = '\0';
+}
+static bool hexToRom(const String& src, Sensor_rom rom) {
+  if (src.length() != 16) return false;
+  for (int i=0;i<16;i++) {
+    char c = src[i]; int v;
+    if (c>='0' && c<='9') v = c-'0';
+    else if (c>='a' && c<='f') v = c-'a'+10;
+    else if (c>='A' && c<='F') v = c-'A'+10;
+    else return false;
+    if (i & 1) rom[i/2] |= v; else rom[i/2] = v << 4;
+  }
+  return true;
+}
+static void writeSensorMap(API_JsonWriter& w) {
+  // Roles: 0 = ambiente, 1.. = nodos. present=false si la verificación
+  // no encontró el sensor; unknown = sensores en el bus sin rol
+  // Una sola lectura del mapa publicado: la tarea de muestreo puede
+  // estar reescribiendo sus tablas
+  Sensors_map m = Temperature.get_map();
+  char hex[17];
+  w.begin_object();
+  w.field("verified", m.verified);
+  w.field("pending", Temperature.remap_pending());
+  w.key("roles"); w.begin_array();
+  for (int i=0;i<DEVICES_CONNECT;i++){
+    w.begin_object();
+    w.field("role", i);
+    if (m.bus[i] >= 0) {
+      romToHex(m.rom[i], hex);
+      w.field("rom", (const char*)hex);
+      w.field("bus", (int)m.bus[i]);
+      w.field("present", (m.missing & (1UL<<i)) == 0);
+    } else {
+      w.key("rom"); w.value_null();
+    }
+    w.end_object();
+  }
+  w.end_array();
+  w.key("unknown"); w.begin_array();
+  for (int k=0;k<m.unknown_count;k++){
+    romToHex(m.unknown[k], hex);
+    w.begin_object(); w.field("rom", (const char*)hex); w.field("bus", (int)m.unknown_bus[k]); w.end_object();
+  }
+  w.end_array();
+  w.end_object();
+}
+static void handleSensorMap(Http_req& r) {
+  API_JsonWriter w(r.buf, r.cap);
+  writeSensorMap(w);
+  sendJson(r, w);
+}
+static void handleSensorRemap(Http_req& r) {
+  // rebuild=1: orden de búsqueda; role+rom: asigna (o intercambia) un rol
+  if (reqHasArg(r, "rebuild") && reqArg(r, "rebuild").toInt() != 0) {
+    Temperature.rebuild_map();
+    Serial.println("[API] sensor map rebuild");
+    sendJson(r, "{\"ok\":true}");
+    return;
+  }
+  // Rango sobre el int antes de pasar a uint8_t (256 no debe ser el rol 0)
+  Sensor_rom rom;
+  int role = reqArg(r, "role").toInt();
+  if (!reqHasArg(r, "role") || role < 0 || role >= DEVICES_CONNECT ||
+      !hexToRom(reqArg(r, "rom"), rom) || !Temperature.set_role(role, rom)) {
+    sendJson(r, "{\"error\":\"role out of range, rom 16 hex\"}", 400);
+    return;
+  }
+  Serial.println(String("[API] role ") + role + " <- " + reqArg(r, "rom"));
+  sendJson(r, "{\"ok\":true}");
+}
+static void handleHeaterCalibration(Http_req& r) {
+  // Dos puntos medidos: código ADC crudo y mV en el pin del ADC. Rango
+  // sobre los int antes de pasar a uint16_t (65541 no debe ser el código 5)
+  int raw_lo = reqArg(r, "raw_lo").toInt(), mv_lo = reqArg(r, "mv_lo").toInt();
+  int raw_hi = reqArg(r, "raw_hi").toInt(), mv_hi = reqArg(r, "mv_hi").toInt();
+  bool in_range = raw_lo >= 0 && raw_lo < raw_hi && raw_hi < RESISTOR_ADC_CODES &&
+                  mv_lo >= 0 && mv_lo < mv_hi && mv_hi <= RESISTOR_CAL_MV_MAX;
+  if (in_range && Qin.set_two_point_calibration(raw_lo, mv_lo, raw_hi, mv_hi)) {
+    Serial.println(String("[API] heater cal ") + raw_lo + ":" + mv_lo + " " + raw_hi + ":" + mv_hi);
+    sendJson(r, "{\"ok\":true}");
+  }
+  else sendJson(r, "{\"error\":\"raw_lo<raw_hi (0-4095), mv_lo<mv_hi\"}", 400);
+}
+static void handleCooler(Http_req& r) {
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_COOLER;
+  patch.cooler_percent = reqArg(r, "percent").toInt();
+  if (applyConfig(patch)) sendJson(r, "{\"error\":\"percent 0-100\"}", 400);
+  else sendJson(r, "{\"ok\":true}");
+}
+static const char* calibrationName(Resistor_cal cal) {
+  switch (cal) {
+    case RESISTOR_CAL_TWO_POINT:  return "two_point";
+    case RESISTOR_CAL_EFUSE_TP:   return "efuse_tp";
+    case RESISTOR_CAL_EFUSE_VREF: return "efuse_vref";
+    default:                      return "default_vref";
+  }
+}
+// Suscriptores de /api/stream (SSE): un frame por muestra nueva. Cada
+// cliente tiene su socket; si no admite el frame entero sin bloquear, el
+// frame se descarta para ese cliente (los lentos pierden muestras, no
+// frenan el loop ni a los demás)
+#define HTTP_STREAM_BUF          512
+#define HTTP_STREAM_HEARTBEAT_MS 15000
+struct Stream_client {
+      bool active;
+      int fd;
+#if HTTP_BACKEND != HTTP_BACKEND_IDF
+      WiFiClient client;            // mantiene abierto el socket
+#endif
+      uint32_t sent;
+      uint32_t dropped;
+    };
+static Stream_client streamClients[HTTP_STREAM_CLIENTS];
+static char streamBuf[HTTP_STREAM_BUF];
+static uint32_t streamSeq = 0;
+static uint32_t streamFrames = 0;
+static uint32_t streamDrops = 0;
+static unsigned long streamLastSendMs = 0;
+static volatile int streamActive = 0;   // leído desde loop() con el backend IDF
+
+static void writeState(API_JsonWriter& w, const Sample_snapshot& snap) {
+  const Temp_raw* temps = snap.temps_raw;
+  w.begin_object();
+  writeSnapshotVersion(w, snap);
+  w.field("running", (bool)g_running);
+  // Configuración vigente, toda de la misma versión
+  Run_config cfg = RunConfig.get();
+  w.field("config_version", cfg.version);
+  w.field("mode", cfg.mode == RUN_MODE_PID ? "pid" : "fixed");
+  w.field("node", (int)cfg.node);
+  w.field("setpoint", cfg.setpoint, 1);
+  w.field("fixed_percent", (int)cfg.fixed_percent);
+  w.field("cooler_percent", (int)cfg.cooler_percent);
+  w.key("temperatures"); w.begin_object();
+  w.key("room"); w.value_temp(temps[0]);
+  w.key("nodes"); w.begin_array();
+  for (int i=1;i<DEVICES_CONNECT;i++) w.value_temp(temps[i]);
+  w.end_array();
+  w.end_object();
+  // Resolución vigente y tiempo de conversión de cada sensor (mismo orden)
+  w.key("resolution_bits"); w.begin_array();
+  for (int i=0;i<DEVICES_CONNECT;i++) w.value((int)snap.resolution[i]);
+  w.end_array();
+  w.key("conversion_ms"); w.begin_array();
+  for (int i=0;i<DEVICES_CONNECT;i++) w.value((int)API_Sensors::conversion_ms(snap.resolution[i]));
+  w.end_array();
+  // Tiempo de bus de la última muestra, para comparar backends 1-Wire
+  w.field("sensors_backend", SENSORS_BACKEND == SENSORS_BACKEND_DSTHERM ? "dstherm" : "dallas");
+  w.field("bus_us", snap.bus_time_us);
+  w.field("sensors_monitor", Temperature.get_monitor_mode());
+  // Salud por sensor (mismo orden); last_good_age_ms = -1 si nunca leyó bien
+  w.key("sensor_health"); w.begin_array();
+  for (int i=0;i<DEVICES_CONNECT;i++){
+    const Sensor_health& h = snap.health[i];
+    w.begin_object();
+    w.field("crc_errors", (int)h.crc_errors);
+    w.field("disconnects", (int)h.disconnects);
+    w.field("power_on_resets", (int)h.power_on_resets);
+    w.field("out_of_range", (int)h.out_of_range);
+    w.field("stuck", (int)h.stuck);
+    w.field("failures", (int)h.failures);
+    w.field("backoff", (int)h.backoff);
+    w.key("last_good_age_ms");
+    if (h.last_good_ms) w.value(millis() - h.last_good_ms); else w.value(-1);
+    w.end_object();
+  }
+  w.end_array();
+  w.field("heater_w", snap.heater_w, 3);
+  w.field("heater_cal", calibrationName(Qin.get_calibration()));
+  w.field("control_pct", Qin.get_set_pwm_percent(), 2);
+  w.field("heater_pwm_bits", (int)Qin.get_pwm_bits());
+  // Salidas: valor aplicado y escrituras efectivas frente a pedidos
+  w.key("actuators"); w.begin_object();
+  w.key("heater"); writeActuator(w, Qin.get_pwm_output(), Qin.get_pwm_stats());
+  w.key("cooler"); writeActuator(w, Cooler.get_output(), Cooler.get_stats());
+  w.end_object();
+  // Lazo de control: dt real, retardo de arranque respecto del tick
+  // (histograma con límites superiores en jitter_bins_us; 0 = resto) y
+  // deadlines incumplidos
+  Control_stats cs = Control.get_stats();
+  w.key("control"); w.begin_object();
+  w.field("period_us", Control.get_period_us());
+  w.field("steps", cs.steps);
+  w.field("misses", cs.misses);
+  w.field("last_dt_s", cs.last_dt_s, 4);
+  w.field("last_jitter_us", cs.last_jitter_us);
+  w.field("max_jitter_us", cs.max_jitter_us);
+  w.field("last_exec_us", cs.last_exec_us);
+  w.field("max_exec_us", cs.max_exec_us);
+  w.key("jitter_bins_us"); w.begin_array();
+  for (int i=0;i<CONTROL_JITTER_BINS;i++) w.value(API_ControlLoop::bin_limit_us(i));
+  w.end_array();
+  w.key("jitter_hist"); w.begin_array();
+  for (int i=0;i<CONTROL_JITTER_BINS;i++) w.value(cs.jitter_hist[i]);
+  w.end_array();
+  w.end_object();
+  // Energía entregada (J): corrida en curso o última, acumulado por modo y
+  // por nodo seleccionado, para comparar corridas fijas y PID
+  Heater_energy e = Qin.get_energy();
+  w.key("energy"); w.begin_object();
+  w.field("total_j", e.total_j, 2);
+  w.field("run_active", e.run_active);
+  w.field("run_mode", e.run_mode ? "pid" : "fixed");
+  w.field("run_j", e.run_j, 2);
+  w.field("run_s", e.run_s, 1);
+  w.field("run_avg_w", e.run_s > 0 ? e.run_j / e.run_s : 0.0f, 3);
+  w.field("run_avg_duty", e.run_duty, 1);
+  w.key("mode_j"); w.begin_object();
+  w.field("fixed", e.mode_j[0], 2);
+  w.field("pid", e.mode_j[1], 2);
+  w.end_object();
+  w.key("node_j"); w.begin_array();
+  for (int i=0;i<RESISTOR_ENERGY_NODES;i++) w.value(e.node_j[i], 2);
+  w.end_array();
+  w.end_object();
+  // Stream SSE: clientes conectados, frames generados y descartados
+  w.key("stream"); w.begin_object();
+  w.field("clients", (int)streamActive);
+  w.field("frames", streamFrames);
+  w.field("drops", streamDrops);
+  w.end_object();
+  w.end_object();
+}
+static void handleState(Http_req& r) {
+  API_JsonWriter w(r.buf, r.cap);
+  // Último snapshot de la tarea de muestreo: no toca el bus 1-Wire
+  writeState(w, Sampler.snapshot());
+  sendJson(r, w);
 }
 
 // --- Shims de compatibilidad para rutas antiguas (/api/config/*) ---
@@ -101,7 +511,8 @@ static bool parseIntField(const String& src, const char* key, int& out) {
   while (pos < (int)src.length() && isspace((unsigned char)src[pos])) pos++;
   int sign = 1; if (pos < (int)src.length() && src[pos]=='-') { sign = -1; pos++; }
   long val = 0; bool any=false; while (pos < (int)src.length() && isdigit((unsigned char)src[pos])) { val = val*10 + (src[pos]-'0'); pos++; any=true; }
-  if (!any) return false; out = (int)(sign*val); return true;
+  if (!any) return false;
+  out = (int)(sign*val); return true;
 }
 static bool parseFloatField(const String& src, const char* key, float& out) {
   int pos = src.indexOf(String("\"") + key + "\""); if (pos < 0) return false;
@@ -114,40 +525,53 @@ static bool parseFloatField(const String& src, const char* key, float& out) {
   out = num.toFloat();
   return true;
 }
-static void handleConfigControl() {
-  String body = server.arg("plain");
+static void sendConfigResult(Http_req& r, const char* err) {
+  if (!err) { sendJson(r, "{\"ok\":true}"); return; }
+  API_JsonWriter w(r.buf, r.cap);
+  w.begin_object(); w.field("error", err); w.end_object();
+  sendJson(r, w, 400);
+}
+static void handleConfigControl(Http_req& r) {
+  String body = reqArg(r, "plain");
   int node = 1; float target = 30.0f; int coolerSpeed = 3;
   parseIntField(body, "node", node);
   parseFloatField(body, "targetTemp", target);
   parseIntField(body, "coolerSpeed", coolerSpeed);
-  if (node < 1 || node > 4) node = 1;
+  if (node < 1 || node >= DEVICES_CONNECT) node = 1;
   int coolerPct = (coolerSpeed<=0?0: coolerSpeed==1?33: coolerSpeed==2?66: 100);
-  g_mode = 1; g_selectedNode = node; g_setpoint = target; g_coolerPercent = coolerPct;
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_MODE | RUN_CFG_NODE | RUN_CFG_SETPOINT | RUN_CFG_COOLER;
+  patch.mode = RUN_MODE_PID; patch.node = node; patch.setpoint = target; patch.cooler_percent = coolerPct;
   Serial.printf("[Shim] control pid node=%d sp=%.1f cooler%%=%d\n", node, target, coolerPct);
-  sendJson("{\"ok\":true}");
+  sendConfigResult(r, applyConfig(patch));
 }
-static void handleConfigOnOff() {
-  String body = server.arg("plain");
+static void handleConfigOnOff(Http_req& r) {
+  String body = reqArg(r, "plain");
   int node = 1; float target = 30.0f; int coolerSpeed = 3;
   parseIntField(body, "node", node);
   parseFloatField(body, "targetTemp", target);
   parseIntField(body, "coolerSpeed", coolerSpeed);
-  if (node < 1 || node > 4) node = 1;
+  if (node < 1 || node >= DEVICES_CONNECT) node = 1;
   int coolerPct = (coolerSpeed<=0?0: coolerSpeed==1?33: coolerSpeed==2?66: 100);
-  g_mode = 1; g_selectedNode = node; g_setpoint = target; g_coolerPercent = coolerPct;
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_MODE | RUN_CFG_NODE | RUN_CFG_SETPOINT | RUN_CFG_COOLER;
+  patch.mode = RUN_MODE_PID; patch.node = node; patch.setpoint = target; patch.cooler_percent = coolerPct;
   Serial.printf("[Shim] onoff=>pid node=%d sp=%.1f cooler%%=%d\n", node, target, coolerPct);
-  sendJson("{\"ok\":true}");
+  sendConfigResult(r, applyConfig(patch));
 }
-static void handleConfigManual() {
-  String body = server.arg("plain");
+static void handleConfigManual(Http_req& r) {
+  String body = reqArg(r, "plain");
   int pwm = 0; int coolerSpeed = 3;
   parseIntField(body, "pwmPercent", pwm);
   parseIntField(body, "coolerSpeed", coolerSpeed);
-  if (pwm<0) pwm=0; if (pwm>100) pwm=100;
+  if (pwm<0) pwm=0;
+  if (pwm>100) pwm=100;
   int coolerPct = (coolerSpeed<=0?0: coolerSpeed==1?33: coolerSpeed==2?66: 100);
-  g_mode = 0; g_fixedPercent = pwm; g_coolerPercent = coolerPct;
+  Run_config_patch patch = Run_config_patch();
+  patch.fields = RUN_CFG_MODE | RUN_CFG_FIXED | RUN_CFG_COOLER;
+  patch.mode = RUN_MODE_FIXED; patch.fixed_percent = pwm; patch.cooler_percent = coolerPct;
   Serial.printf("[Shim] manual fixed%%=%d cooler%%=%d\n", pwm, coolerPct);
-  sendJson("{\"ok\":true}");
+  sendConfigResult(r, applyConfig(patch));
 }
 
 static bool startSTA(unsigned long timeout_ms = 15000) {
@@ -185,77 +609,359 @@ static void startAP() {
 
 // Nota: Se eliminó el endpoint de mock; ahora sólo datos reales
 
-static void handleSensors() {
-  float temps[DEVICES_CONNECT] = {0};
-  Temperature.getTemperatures(temps);
-  String json = "{";
-  // Temperaturas separadas: ambiente y nodos 1..4
-  json += "\"temperatures\":{\"room\":";
-  json += String(temps[0], 2);
-  json += ",\"nodes\":[";
-  for (int i=1;i<=4;i++) {
-    if (i>1) json += ",";
-    json += String(temps[i], 2);
-  }
-  json += "]}";
+static void writeSensors(API_JsonWriter& w, const Sample_snapshot& snap) {
+  const Temp_raw* temps = snap.temps_raw;
+  w.begin_object();
+  writeSnapshotVersion(w, snap, false);
+  // Temperaturas separadas: ambiente y nodos 1..DEVICES_CONNECT-1
+  w.key("temperatures"); w.begin_object();
+  w.key("room"); w.value_temp(temps[0]);
+  w.key("nodes"); w.begin_array();
+  for (int i=1;i<DEVICES_CONNECT;i++) w.value_temp(temps[i]);
+  w.end_array();
+  w.end_object();
   // Agrega medición de potencia del calefactor (aprox acción de control)
-  json += ",\"heater_w\":" + String(Qin.get_heat(), 3);
-  json += "}";
-  sendJson(json);
+  w.field("heater_w", snap.heater_w, 3);
+  w.end_object();
+}
+// Nonce de arranque para el ETag: seq vuelve a empezar en cada reinicio
+static uint32_t sensorsEtagBoot = 0;
+
+static void handleSensors(Http_req& r) {
+  Sample_snapshot snap = Sampler.snapshot();
+  // Todo lo que sirve sale del snapshot: mismo arranque y seq = misma respuesta
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%08lx-s%lu\"", (unsigned long)sensorsEtagBoot, (unsigned long)snap.seq);
+  reqSetHeader(r, "ETag", etag);
+  if (snap.seq && reqHeader(r, "If-None-Match") == etag) {
+    sendJson(r, "", 304);
+    return;
+  }
+  API_JsonWriter w(r.buf, r.cap);
+  writeSensors(w, snap);
+  sendJson(r, w);
+}
+
+// Frame SSE compacto: subconjunto de /api/state con lo que cambia en cada
+// muestra, para que los clientes lo procesen igual que el sondeo
+static size_t writeStreamFrame(const Sample_snapshot& snap) {
+  int n = snprintf(streamBuf, sizeof(streamBuf), "id: %lu\ndata: ", (unsigned long)snap.seq);
+  API_JsonWriter w(streamBuf + n, sizeof(streamBuf) - n - 2);
+  const Temp_raw* temps = snap.temps_raw;
+  w.begin_object();
+  writeSnapshotVersion(w, snap);
+  w.field("running", (bool)g_running);
+  // Configuración vigente, toda de la misma versión
+  Run_config cfg = RunConfig.get();
+  w.field("config_version", cfg.version);
+  w.field("mode", cfg.mode == RUN_MODE_PID ? "pid" : "fixed");
+  w.field("node", (int)cfg.node);
+  w.field("setpoint", cfg.setpoint, 1);
+  w.field("fixed_percent", (int)cfg.fixed_percent);
+  w.field("cooler_percent", (int)cfg.cooler_percent);
+  w.key("temperatures"); w.begin_object();
+  w.key("room"); w.value_temp(temps[0]);
+  w.key("nodes"); w.begin_array();
+  for (int i=1;i<DEVICES_CONNECT;i++) w.value_temp(temps[i]);
+  w.end_array();
+  w.end_object();
+  w.field("heater_w", snap.heater_w, 3);
+  w.field("control_pct", Qin.get_set_pwm_percent(), 2);
+  w.end_object();
+  if (!w.ok()) return 0;
+  size_t len = n + w.length();
+  streamBuf[len++] = '\n';
+  streamBuf[len++] = '\n';
+  return len;
+}
+
+static void streamClose(Stream_client& c) {
+  if (!c.active) return;
+  c.active = false;
+  streamActive--;
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+  // El socket es de la sesión de httpd: se pide el cierre (llega a onClose)
+  httpd_sess_trigger_close(httpd, c.fd);
+#else
+  c.client.stop();
+  c.client = WiFiClient();
+#endif
+}
+
+// Envío sin bloquear: el frame (< TCP_SNDLOWAT) entra entero si el socket
+// está escribible; si no, se descarta. Devuelve false si la conexión murió
+static bool streamSend(Stream_client& c, const char* buf, size_t len) {
+  int fd = c.fd;
+  if (fd < 0) return false;
+  fd_set wr;
+  FD_ZERO(&wr);
+  FD_SET(fd, &wr);
+  struct timeval tv = { 0, 0 };
+  if (select(fd + 1, NULL, &wr, NULL, &tv) <= 0) {
+    c.dropped++;
+    streamDrops++;
+    return true;
+  }
+  int sent = send(fd, buf, len, MSG_DONTWAIT);
+  if (sent == (int)len) { c.sent++; return true; }
+  if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    c.dropped++;
+    streamDrops++;
+    return true;
+  }
+  // Frame a medias o error: el stream quedaría corrupto, se cierra
+  return false;
+}
+
+static void streamBroadcast(const char* buf, size_t len) {
+  for (int i=0;i<HTTP_STREAM_CLIENTS;i++) {
+    Stream_client& c = streamClients[i];
+    if (!c.active) continue;
+    if (!streamSend(c, buf, len)) { streamClose(c); continue; }
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+    // El navegador no manda pedidos por el stream: sin esto la sesión
+    // sería siempre la menos usada y la purga LRU la cerraría primero
+    httpd_sess_update_lru_counter(httpd, c.fd);
+#endif
+  }
+  streamLastSendMs = millis();
+}
+
+static const char streamHead[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/event-stream\r\n"
+  "Cache-Control: no-cache\r\n"
+  "Connection: keep-alive\r\n"
+  "Access-Control-Allow-Origin: *\r\n"
+  "\r\n"
+  "retry: 2000\n\n";
+
+// La respuesta no termina: cabeceras a mano y el socket pasa a la tabla
+// de suscriptores. Devuelve false si no se pudo enviar
+static bool streamAttach(Http_req& r, Stream_client& c) {
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+  // La sesión sigue abierta en httpd tras el handler; el navegador no
+  // manda más pedidos por ella
+  if (httpd_send(r.raw, streamHead, sizeof(streamHead) - 1) != (int)sizeof(streamHead) - 1) return false;
+  c.fd = httpd_req_to_sockfd(r.raw);
+#else
+  // WiFiClient comparte el socket: WebServer no lo cierra al soltarlo
+  (void)r;
+  c.client = server.client();
+  if (c.client.print(streamHead) != sizeof(streamHead) - 1) { c.client = WiFiClient(); return false; }
+  c.fd = c.client.fd();
+#endif
+  c.active = true;
+  c.sent = 0;
+  c.dropped = 0;
+  streamActive++;
+  return true;
+}
+
+static void handleStream(Http_req& r) {
+  int slot = -1;
+  for (int i=0;i<HTTP_STREAM_CLIENTS;i++) {
+    if (!streamClients[i].active) { slot = i; break; }
+  }
+  if (slot < 0) { sendJson(r, "{\"error\":\"too many stream clients\"}", 503); return; }
+  Stream_client& c = streamClients[slot];
+  if (!streamAttach(r, c)) return;
+  // Primer frame inmediato con la última muestra
+  Sample_snapshot snap = Sampler.snapshot();
+  size_t len = snap.seq ? writeStreamFrame(snap) : 0;
+  if (len && !streamSend(c, streamBuf, len)) streamClose(c);
+}
+
+// Un frame por muestra completada; comentario periódico para que proxies
+// y navegadores no den por muerta una conexión sin muestras
+static void streamLoop() {
+  if (!streamActive) return;
+  Sample_snapshot snap = Sampler.snapshot();
+  if (snap.seq != streamSeq) {
+    streamSeq = snap.seq;
+    size_t len = writeStreamFrame(snap);
+    if (len) { streamFrames++; streamBroadcast(streamBuf, len); }
+  } else if (millis() - streamLastSendMs >= HTTP_STREAM_HEARTBEAT_MS) {
+    streamBroadcast(": ping\n\n", 8);
+  }
 }
 
+static void handleOptions(Http_req& r) { sendJson(r, "{}", 204); }
+
+static void handleRoot(Http_req& r) {
+  String msg = "ESP32 API running. ";
+  if (WiFi.getMode() & WIFI_MODE_STA && WiFi.status() == WL_CONNECTED) {
+    msg += "STA IP: " + WiFi.localIP().toString();
+  } else {
+    msg += String("AP SSID: ") + WIFI_AP_SSID + ", IP: " + WiFi.softAPIP().toString();
+  }
+  msg += ", endpoints: /api/health, /api/sensors, /api/state, /api/stream, /api/run, /api/stop, /api/mode, /api/node, /api/setpoint, /api/fixed, /api/cooler, /api/resolution, /api/sensors/map, /api/heater/calibration, /api/config";
+  reqSend(r, 200, "text/plain", msg.c_str(), msg.length());
+}
+
+// Tabla de rutas, la misma para los dos backends. Cada path con cors=true
+// responde también el preflight OPTIONS (una vez por path)
+struct Http_route {
+      const char* path;
+      http_method method;
+      Http_handler fn;
+      bool cors;
+    };
+static const Http_route routes[] = {
+  { "/api/health", HTTP_GET, handleHealth, true },
+  { "/api/sensors", HTTP_GET, handleSensors, true },
+  // Compatibilidad con dashboard anterior
+  { "/api/config/control", HTTP_POST, handleConfigControl, true },
+  { "/api/config/onoff", HTTP_POST, handleConfigOnOff, true },
+  { "/api/config/manual", HTTP_POST, handleConfigManual, true },
+  { "/api/state", HTTP_GET, handleState, true },
+  { "/api/stream", HTTP_GET, handleStream, true },
+  { "/api/run", HTTP_POST, handleRunStart, true },
+  { "/api/stop", HTTP_POST, handleRunStop, true },
+  { "/api/mode", HTTP_POST, handleMode, true },
+  { "/api/node", HTTP_POST, handleNode, true },
+  { "/api/setpoint", HTTP_POST, handleSetpoint, true },
+  { "/api/fixed", HTTP_POST, handleFixed, true },
+  { "/api/cooler", HTTP_POST, handleCooler, true },
+  { "/api/resolution", HTTP_POST, handleResolution, true },
+  { "/api/sensors/map", HTTP_GET, handleSensorMap, true },
+  { "/api/sensors/map", HTTP_POST, handleSensorRemap, false },
+  { "/api/heater/calibration", HTTP_POST, handleHeaterCalibration, true },
+  { "/api/config", HTTP_GET, handleConfig, true },
+  { "/api/config", HTTP_POST, handleConfig, false },
+  // Raíz sencilla
+  { "/", HTTP_GET, handleRoot, false },
+};
+#define HTTP_ROUTES ((int)(sizeof(routes) / sizeof(routes[0])))
+
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+static esp_err_t idfRoute(httpd_req_t* raw) {
+  // Búfer JSON y argumentos en la pila de la tarea HTTP (HTTP_TASK_STACK)
+  char json[HTTP_JSON_BUF];
+  Http_req r;
+  r.buf = json;
+  r.cap = sizeof(json);
+  r.raw = raw;
+  r.hdrs = 0;
+  r.query[0] = '\0';
+  r.body[0] = '\0';
+  r.form = false;
+  httpd_req_get_url_query_str(raw, r.query, sizeof(r.query));
+  if (raw->content_len > HTTP_BODY_MAX) {
+    sendJson(r, "{\"error\":\"body too large\"}", 413);
+    return ESP_OK;
+  }
+  size_t got = 0;
+  while (got < raw->content_len) {
+    // Timeout (HTTP_TIMEOUT_S) o error: httpd cierra la conexión
+    int n = httpd_req_recv(raw, r.body + got, raw->content_len - got);
+    if (n <= 0) return ESP_FAIL;
+    got += n;
+  }
+  r.body[got] = '\0';
+  char type[48];
+  if (httpd_req_get_hdr_value_str(raw, "Content-Type", type, sizeof(type)) == ESP_OK)
+    r.form = strstr(type, "x-www-form-urlencoded") != NULL;
+  ((const Http_route*)raw->user_ctx)->fn(r);
+  return ESP_OK;
+}
+static esp_err_t idfOptions(httpd_req_t* raw) {
+  Http_req r = Http_req();
+  r.raw = raw;
+  handleOptions(r);
+  return ESP_OK;
+}
+// httpd cierra una sesión (cliente, LRU o stream cerrado): si era un
+// suscriptor se libera el slot antes de que el fd se reutilice
+static void idfOnClose(httpd_handle_t, int fd) {
+  for (int i=0;i<HTTP_STREAM_CLIENTS;i++) {
+    Stream_client& c = streamClients[i];
+    if (c.active && c.fd == fd) { c.active = false; streamActive--; }
+  }
+  close(fd);
+}
+static volatile bool streamQueued = false;
+static uint32_t streamQueuedSeq = 0;
+static unsigned long streamQueuedMs = 0;
+static void idfStreamWork(void*) {
+  streamQueued = false;
+  streamLoop();
+}
+#endif
+
 void httpServerSetup() {
+  sensorsEtagBoot = esp_random();
   // Intenta STA y, si falla, cae a AP
   bool sta_ok = startSTA();
   if (!sta_ok) {
     startAP();
   }
 
-  // Rutas API
-  server.on("/api/health", HTTP_GET, handleHealth);
-  server.on("/api/sensors", HTTP_GET, handleSensors);
-  // Compatibilidad con dashboard anterior
-  server.on("/api/config/control", HTTP_POST, handleConfigControl);
-  server.on("/api/config/onoff", HTTP_POST, handleConfigOnOff);
-  server.on("/api/config/manual", HTTP_POST, handleConfigManual);
-  // CORS preflight (OPTIONS)
-  server.on("/api/health", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/sensors", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/config/control", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/config/onoff", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/config/manual", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/state", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/run", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/stop", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/mode", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/node", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/setpoint", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/fixed", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/cooler", HTTP_OPTIONS, [](){ sendJson("{}", 204); });
-  server.on("/api/state", HTTP_GET, handleState);
-  server.on("/api/run", HTTP_POST, handleRunStart);
-  server.on("/api/stop", HTTP_POST, handleRunStop);
-  server.on("/api/mode", HTTP_POST, handleMode);
-  server.on("/api/node", HTTP_POST, handleNode);
-  server.on("/api/setpoint", HTTP_POST, handleSetpoint);
-  server.on("/api/fixed", HTTP_POST, handleFixed);
-  server.on("/api/cooler", HTTP_POST, handleCooler);
-
-  // Raíz sencilla
-  server.on("/", HTTP_GET, [](){
-    String msg = "ESP32 API running. ";
-    if (WiFi.getMode() & WIFI_MODE_STA && WiFi.status() == WL_CONNECTED) {
-      msg += "STA IP: " + WiFi.localIP().toString();
-    } else {
-      msg += String("AP SSID: ") + WIFI_AP_SSID + ", IP: " + WiFi.softAPIP().toString();
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.core_id = HTTP_TASK_CORE;
+  config.task_priority = HTTP_TASK_PRIORITY;
+  config.stack_size = HTTP_TASK_STACK;
+  config.max_open_sockets = HTTP_MAX_CONNECTIONS;
+  config.max_uri_handlers = HTTP_MAX_URI_HANDLERS;
+  config.lru_purge_enable = true;
+  config.recv_wait_timeout = HTTP_TIMEOUT_S;
+  config.send_wait_timeout = HTTP_TIMEOUT_S;
+  config.close_fn = idfOnClose;
+  if (httpd_start(&httpd, &config) != ESP_OK) {
+    Serial.println("[HTTP] No se pudo iniciar esp_http_server");
+    return;
+  }
+  for (int i=0;i<HTTP_ROUTES;i++) {
+    const Http_route& rt = routes[i];
+    httpd_uri_t uri = {};
+    uri.uri = rt.path;
+    uri.method = rt.method;
+    uri.handler = idfRoute;
+    uri.user_ctx = (void*)&rt;
+    httpd_register_uri_handler(httpd, &uri);
+    if (rt.cors) {
+      uri.method = HTTP_OPTIONS;
+      uri.handler = idfOptions;
+      uri.user_ctx = NULL;
+      httpd_register_uri_handler(httpd, &uri);
     }
-    msg += ", endpoints: /api/health, /api/sensors, /api/state, /api/run, /api/stop, /api/mode, /api/node, /api/setpoint, /api/fixed, /api/cooler";
-    server.send(200, "text/plain", msg);
-  });
-
+  }
+  Serial.println("[HTTP] esp_http_server en tarea propia");
+#else
+  // Rutas API
+  static const char* etagHeaders[] = { "If-None-Match" };
+  server.collectHeaders(etagHeaders, 1);
+  for (int i=0;i<HTTP_ROUTES;i++) {
+    const Http_route& rt = routes[i];
+    Http_handler fn = rt.fn;
+    server.on(rt.path, rt.method, [fn](){
+      Http_req r;
+      r.buf = jsonBuf;
+      r.cap = sizeof(jsonBuf);
+      fn(r);
+    });
+    // CORS preflight (OPTIONS)
+    if (rt.cors) server.on(rt.path, HTTP_OPTIONS, [](){ Http_req r = Http_req(); handleOptions(r); });
+  }
   server.begin();
+#endif
 }
 
 void httpServerLoop() {
+#if HTTP_BACKEND == HTTP_BACKEND_IDF
+  // Los pedidos se atienden en la tarea HTTP; el stream también se envía
+  // desde ella (dueña de los sockets) cuando hay muestra nueva o ping
+  if (!httpd || !streamActive || streamQueued) return;
+  uint32_t seq = Sampler.snapshot().seq;
+  unsigned long now = millis();
+  if (seq == streamQueuedSeq && now - streamQueuedMs < 1000) return;
+  streamQueuedSeq = seq;
+  streamQueuedMs = now;
+  streamQueued = true;
+  if (httpd_queue_work(httpd, idfStreamWork, NULL) != ESP_OK) streamQueued = false;
+#else
   server.handleClient();
+  streamLoop();
+#endif
 }
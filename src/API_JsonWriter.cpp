@@ -0,0 +1,134 @@
+#include "API_JsonWriter.h"
+#include <string.h>
+
+API_JsonWriter::API_JsonWriter(char* buf, size_t capacity) {
+  __buf = buf;
+  __cap = capacity;
+  API_JsonWriter::reset();
+}
+
+void API_JsonWriter::reset() {
+  __len = 0;
+  __overflow = __cap == 0;
+  __depth = 0;
+  __first = 1;
+  __after_key = false;
+  if (__cap) __buf[0] = '\0';
+}
+
+void API_JsonWriter::put(char c) {
+  if (__len + 1 >= __cap) { __overflow = true; return; }
+  __buf[__len++] = c;
+  __buf[__len] = '\0';
+}
+
+void API_JsonWriter::put(const char* s, size_t n) {
+  if (__len + n >= __cap) { __overflow = true; return; }
+  memcpy(__buf + __len, s, n);
+  __len += n;
+  __buf[__len] = '\0';
+}
+
+void API_JsonWriter::separator() {
+  // Tras una clave el valor va pegado; si no, coma salvo el primero
+  if (__after_key) { __after_key = false; return; }
+  if (__first & (1U << __depth)) __first &= ~(1U << __depth);
+  else API_JsonWriter::put(',');
+}
+
+void API_JsonWriter::open(char c) {
+  API_JsonWriter::separator();
+  API_JsonWriter::put(c);
+  if (__depth + 1 >= JSON_MAX_DEPTH) { __overflow = true; return; }
+  __depth++;
+  __first |= 1U << __depth;
+}
+
+void API_JsonWriter::close(char c) {
+  if (__depth) __depth--;
+  __after_key = false;
+  API_JsonWriter::put(c);
+}
+
+void API_JsonWriter::begin_object() { API_JsonWriter::open('{'); }
+void API_JsonWriter::end_object() { API_JsonWriter::close('}'); }
+void API_JsonWriter::begin_array() { API_JsonWriter::open('['); }
+void API_JsonWriter::end_array() { API_JsonWriter::close(']'); }
+
+void API_JsonWriter::key(const char* name) {
+  API_JsonWriter::value(name);
+  API_JsonWriter::put(':');
+  __after_key = true;
+}
+
+void API_JsonWriter::value(bool v) {
+  API_JsonWriter::separator();
+  if (v) API_JsonWriter::put("true", 4);
+  else API_JsonWriter::put("false", 5);
+}
+
+void API_JsonWriter::value_null() {
+  API_JsonWriter::separator();
+  API_JsonWriter::put("null", 4);
+}
+
+void API_JsonWriter::value_raw(const char* json) {
+  API_JsonWriter::separator();
+  API_JsonWriter::put(json, strlen(json));
+}
+
+void API_JsonWriter::putInt(bool neg, unsigned long long mag) {
+  API_JsonWriter::separator();
+  char tmp[21];
+  int n = 0;
+  do { tmp[sizeof(tmp) - 1 - n++] = '0' + (char)(mag % 10); mag /= 10; } while (mag);
+  if (neg) tmp[sizeof(tmp) - 1 - n++] = '-';
+  API_JsonWriter::put(tmp + sizeof(tmp) - n, n);
+}
+
+void API_JsonWriter::value(float v, uint8_t decimals) {
+  static const uint32_t pow10[JSON_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  if (decimals > JSON_MAX_DECIMALS) decimals = JSON_MAX_DECIMALS;
+  uint32_t scale = pow10[decimals];
+  // Redondeo al decimal pedido en double. La cota va sobre el valor ya
+  // escalado (INT64_MAX ~ 9.22e18): con 6 decimales, |v| hasta ~9.2e12.
+  // NaN, +-inf y lo que no entra en int64 salen como null
+  double scaled = (double)v * scale;
+  if (!(scaled < 9.2e18 && scaled > -9.2e18)) { API_JsonWriter::value_null(); return; }
+  long long m = (long long)(scaled + (scaled < 0 ? -0.5 : 0.5));
+  bool neg = m < 0;
+  unsigned long long mag = neg ? 0ULL - (unsigned long long)m : (unsigned long long)m;
+
+  API_JsonWriter::separator();
+  char tmp[32];
+  int n = 0;
+  for (int d = 0; d < decimals; d++) { tmp[sizeof(tmp) - 1 - n++] = '0' + (char)(mag % 10); mag /= 10; }
+  if (decimals) tmp[sizeof(tmp) - 1 - n++] = '.';
+  do { tmp[sizeof(tmp) - 1 - n++] = '0' + (char)(mag % 10); mag /= 10; } while (mag);
+  if (neg) tmp[sizeof(tmp) - 1 - n++] = '-';
+  API_JsonWriter::put(tmp + sizeof(tmp) - n, n);
+}
+
+void API_JsonWriter::value_temp(Temp_raw raw) {
+  API_JsonWriter::separator();
+  char tmp[TEMP_RAW_TEXT_MAX];
+  int n = temp_raw_format(tmp, raw);
+  API_JsonWriter::put(tmp, n);
+}
+
+void API_JsonWriter::value(const char* s) {
+  API_JsonWriter::separator();
+  static const char* hex = "0123456789abcdef";
+  API_JsonWriter::put('"');
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') { API_JsonWriter::put('\\'); API_JsonWriter::put((char)c); }
+    else if (c == '\n') API_JsonWriter::put("\\n", 2);
+    else if (c < 0x20) {
+      char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+      API_JsonWriter::put(esc, 6);
+    }
+    else API_JsonWriter::put((char)c);
+  }
+  API_JsonWriter::put('"');
+}
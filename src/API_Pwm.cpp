@@ -0,0 +1,56 @@
+#include "API_Pwm.h"
+
+API_Pwm::API_Pwm(int pin, int channel, uint32_t freq, uint8_t bits, bool dither) {
+    __pin = pin;
+    __channel = channel;
+    __freq = freq;
+    __bits = bits > PWM_MAX_BITS ? PWM_MAX_BITS : bits;
+    __dither = dither;
+    __percent = 0;
+    __target = 0;
+    __error = 0;
+    __duty = 0;
+    __written = false;
+}
+
+bool API_Pwm::begin(){
+    // El contador necesita freq * 2^bits <= reloj del LEDC
+    while (__bits > 1 && ((uint64_t)__freq << __bits) > PWM_LEDC_CLOCK_HZ) __bits--;
+    while (__bits > 1 && ledcSetup(__channel, __freq, __bits) == 0) __bits--;
+    if (__bits <= 1) {
+        Serial.print("[Pwm] Frecuencia fuera de rango en el canal ");
+        Serial.println(__channel);
+        return false;
+    }
+    ledcAttachPin(__pin, __channel);
+    __written = false;
+    API_Pwm::write(__percent);
+    if (__dither) API_Pwm::update();
+    return true;
+}
+
+bool API_Pwm::write(float percent){
+    if (!(percent > 0)) percent = 0;   // también NaN
+    if (percent > 100) percent = 100;
+    __percent = percent;
+    // 2^bits = 100 % en el LEDC
+    __target = percent / 100.0f * (float)(1UL << __bits);
+    if (__dither) return false;
+    return API_Pwm::writeDuty((uint32_t)(__target + 0.5f));
+}
+
+bool API_Pwm::update(){
+    if (!__dither) return false;
+    float v = __target + __error;
+    uint32_t duty = v > 0 ? (uint32_t)v : 0;
+    __error = v - duty;
+    return API_Pwm::writeDuty(duty);
+}
+
+bool API_Pwm::writeDuty(uint32_t duty){
+    if (__written && duty == __duty) return false;
+    __duty = duty;
+    __written = true;
+    ledcWrite(__channel, duty);
+    return true;
+}
@@ -1,21 +1,38 @@
 #include "API_Resistor.h"
 #include <driver/adc.h>
+#include <esp_adc_cal.h>
 #include <esp_log.h>
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
-API_Resistor::API_Resistor() {
+API_Resistor::API_Resistor()
+    : __out(RESISTOR_PIN_OUT, RESISTOR_CHANNEL, RESISTOR_FREQ, RESISTOR_RESOLUTION, RESISTOR_PWM_DITHER) {
     // set defines
-    __pin_out = RESISTOR_PIN_OUT;
-    __channel = RESISTOR_CHANNEL;
     __freq = RESISTOR_FREQ;
-    __resolution = RESISTOR_RESOLUTION;
     __pin_analog_in = HEAT_PIN_AN_IN;
     
-    // init object
-    API_Resistor::init();
-
     // set initial conditions
     __actual_set_pwm_percent = 0;      
     __last_calc_heat = 0.0;
+    __heat_windows = 0;
+    __lut_version = 0;
+    __cal = RESISTOR_CAL_DEFAULT_VREF;
+    __r_scale = 1.0f;
+    __run_request = RUN_NONE;
+    __run_mode = 0;
+    __energy_node = 1;
+    __run_active = false;
+    __energy_last_us = 0;
+    __total_uj = 0;
+    __run_uj = 0;
+    __run_us = 0;
+    __run_duty = 0;
+    for (int i = 0; i < RESISTOR_ENERGY_MODES; i++) __mode_uj[i] = 0;
+    for (int i = 0; i < RESISTOR_ENERGY_NODES; i++) __node_uj[i] = 0;
+
+    // init object
+    API_Resistor::init();
 }
 
 static adc1_channel_t mapPinToAdc1Channel(int pin) {
@@ -33,9 +50,10 @@ static adc1_channel_t mapPinToAdc1Channel(int pin) {
 }
 
 void API_Resistor::init(){
-    ledcSetup(__channel, __freq, __resolution);
-    ledcAttachPin(__pin_out, __channel);
-    API_Resistor::set_pwm(__actual_set_pwm_percent);
+    __out.begin();
+    __out.set_ramp(RESISTOR_RAMP_UP, 0);
+    // Antes de lanzar la tarea del ADC la salida todavía es de init()
+    API_Resistor::update_output();
 
     // Silenciar logs del driver ADC si fueran ruidosos
     esp_log_level_set("ADC", ESP_LOG_NONE);
@@ -44,23 +62,166 @@ void API_Resistor::init(){
     adc1_channel_t ch = mapPinToAdc1Channel(__pin_analog_in);
     adc1_config_width(ADC_WIDTH_BIT_12);
     adc1_config_channel_atten(ch, ADC_ATTEN_DB_12);
+    // Tabla con la característica de eFuse; la de dos puntos (NVS) se
+    // carga después desde setup()
+    API_Resistor::buildLut(nullptr);
 
-    API_Resistor::get_heat();
+    // Primer valor disponible antes de lanzar la tarea
+    API_Resistor::sample_window();
 }
 
-void API_Resistor::set_pwm(int percent){
-    ledcWrite(__channel, 255*(percent/100.0));
+void API_Resistor::set_pwm(float percent){
+    if (!(percent > 0)) percent = 0;   // también NaN
+    if (percent > 100) percent = 100;
+    // Un float alineado: el store es atómico, gana el último pedido
     __actual_set_pwm_percent = percent;
 }
 
-float API_Resistor::get_heat(){
+void API_Resistor::update_output(){
+    __out.set(__actual_set_pwm_percent);
+    __out.update();
+}
+
+void API_Resistor::buildLut(const uint16_t* two_point){
+    esp_adc_cal_characteristics_t chars;
+    if (!two_point) {
+        esp_adc_cal_value_t src = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_12, ADC_WIDTH_BIT_12,
+                                                           RESISTOR_DEFAULT_VREF, &chars);
+        __cal = src == ESP_ADC_CAL_VAL_EFUSE_TP ? RESISTOR_CAL_EFUSE_TP :
+                src == ESP_ADC_CAL_VAL_EFUSE_VREF ? RESISTOR_CAL_EFUSE_VREF : RESISTOR_CAL_DEFAULT_VREF;
+    } else {
+        __cal = RESISTOR_CAL_TWO_POINT;
+    }
+    __lut_version++;
+    for (int raw = 0; raw < RESISTOR_ADC_CODES; raw++) {
+        float mv;
+        if (two_point) {
+            // Recta por (raw_lo, mv_lo) y (raw_hi, mv_hi)
+            mv = two_point[1] + (float)(raw - two_point[0]) * (two_point[3] - two_point[1]) / (two_point[2] - two_point[0]);
+            if (mv < 0) mv = 0;
+        } else {
+            mv = esp_adc_cal_raw_to_voltage(raw, &chars);
+        }
+        // Conversión a tensión real de la resistencia; potencia V^2/R
+        float real_voltage = mv / 1000.0f * READ_TO_REAL_VOLTAGE;
+        float watts = real_voltage * real_voltage / RESISTOR_VALUE;
+        float code = watts * RESISTOR_LUT_PER_W + 0.5f;
+        __power_lut[raw] = code > 65535.0f ? 65535 : (uint16_t)code;
+    }
+    __lut_version++;
+}
+
+bool API_Resistor::set_two_point_calibration(uint16_t raw_lo, uint16_t mv_lo, uint16_t raw_hi, uint16_t mv_hi){
+    if (raw_hi <= raw_lo || raw_hi >= RESISTOR_ADC_CODES || mv_hi <= mv_lo) return false;
+    uint16_t cal[4] = { raw_lo, mv_lo, raw_hi, mv_hi };
+    Preferences prefs;
+    if (prefs.begin(RESISTOR_CAL_NAMESPACE, false)) {
+        prefs.putBytes("cal2p", cal, sizeof(cal));
+        prefs.end();
+    }
+    API_Resistor::buildLut(cal);
+    return true;
+}
+
+void API_Resistor::load_calibration(){
+    uint16_t cal[4];
+    Preferences prefs;
+    if (!prefs.begin(RESISTOR_CAL_NAMESPACE, true)) return;
+    size_t len = prefs.getBytes("cal2p", cal, sizeof(cal));
+    prefs.end();
+    if (len == sizeof(cal) && cal[2] > cal[0] && cal[2] < RESISTOR_ADC_CODES && cal[3] > cal[1]) {
+        API_Resistor::buildLut(cal);
+    }
+}
+
+void API_Resistor::set_temperature(float tempC){
+    // Una multiplicación por ventana, no por muestra
+    __r_scale = 1.0f / (1.0f + RESISTOR_TEMPCO * (tempC - RESISTOR_TEMP_REF));
+}
+
+bool API_Resistor::begin_sampling(){
+    BaseType_t ok = xTaskCreatePinnedToCore(API_Resistor::task, "heater_adc", RESISTOR_ADC_STACK,
+                                            this, RESISTOR_ADC_PRIORITY, nullptr, RESISTOR_ADC_CORE);
+    if (ok != pdPASS) {
+        Serial.println("[Resistor] No se pudo crear la tarea del ADC");
+        return false;
+    }
+    return true;
+}
+
+void API_Resistor::sample_window(){
     // Lectura mediante driver IDF (ADC1)
     adc1_channel_t ch = mapPinToAdc1Channel(__pin_analog_in);
-    int raw = adc1_get_raw(ch);
-    float read_voltage = (raw * 3.3f) / 4095.0f;
-    // Conversión a tensión real de la resistencia
-    float real_voltage = read_voltage * READ_TO_REAL_VOLTAGE;
-    // Potencia: V^2/R
-    __last_calc_heat = (real_voltage * real_voltage) / RESISTOR_VALUE;
-    return __last_calc_heat;
+    unsigned long window_us = RESISTOR_ADC_PERIODS * 1000000UL / __freq;
+    uint32_t sum = 0;
+    uint32_t version = __lut_version;
+    unsigned long t0 = micros();
+    for (int i = 0; i < RESISTOR_ADC_SAMPLES; i++) {
+        // Instante de la muestra i dentro de la ventana
+        unsigned long due = (unsigned long)((uint64_t)i * window_us / RESISTOR_ADC_SAMPLES);
+        unsigned long elapsed = micros() - t0;
+        if (due > elapsed) delayMicroseconds(due - elapsed);
+        int raw = adc1_get_raw(ch);
+        // Potencia instantánea por tabla: la media es <V^2>/R, no <V>^2/R
+        sum += __power_lut[raw & (RESISTOR_ADC_CODES - 1)];
+    }
+    // Tabla reconstruida durante la ventana (o en curso): se descarta
+    if (version != __lut_version || (version & 1)) return;
+    __last_calc_heat = (float)sum / (RESISTOR_ADC_SAMPLES * RESISTOR_LUT_PER_W) * __r_scale;
+    __heat_windows++;
+    API_Resistor::integrateEnergy(__last_calc_heat);
+}
+
+void API_Resistor::integrateEnergy(float watts){
+    unsigned long now = micros();
+    // Primera ventana: sin tramo previo
+    unsigned long dt = __heat_windows > 1 ? now - __energy_last_us : 0;
+    __energy_last_us = now;
+    if (dt > RESISTOR_ENERGY_MAX_DT_US) dt = RESISTOR_ENERGY_MAX_DT_US;
+
+    // Pedidos de corrida: el tramo previo al pedido queda en el estado anterior
+    uint8_t req = __run_request;
+    __run_request = RUN_NONE;
+    if (req == RUN_END) __run_active = false;
+
+    // W * us = uJ
+    uint64_t uj = (uint64_t)(watts * dt + 0.5f);
+    __total_uj += uj;
+    if (__run_active) {
+        uint8_t mode = __run_mode < RESISTOR_ENERGY_MODES ? __run_mode : 0;
+        uint8_t node = __energy_node < RESISTOR_ENERGY_NODES ? __energy_node : 0;
+        __run_uj += uj;
+        __run_us += dt;
+        __run_duty += (uint64_t)(__out.get_output() * dt + 0.5f);
+        __mode_uj[mode] += uj;
+        __node_uj[node] += uj;
+    }
+
+    if (req == RUN_BEGIN) {
+        __run_active = true;
+        __run_uj = 0;
+        __run_us = 0;
+        __run_duty = 0;
+    }
+
+    Heater_energy e;
+    e.total_j = __total_uj / 1e6f;
+    e.run_j = __run_uj / 1e6f;
+    e.run_s = __run_us / 1e6f;
+    e.run_duty = __run_us ? (float)__run_duty / __run_us : 0.0f;
+    e.run_active = __run_active;
+    e.run_mode = __run_mode;
+    for (int i = 0; i < RESISTOR_ENERGY_MODES; i++) e.mode_j[i] = __mode_uj[i] / 1e6f;
+    for (int i = 0; i < RESISTOR_ENERGY_NODES; i++) e.node_j[i] = __node_uj[i] / 1e6f;
+    __energy.publish(e);
+}
+
+void API_Resistor::task(void* arg){
+    API_Resistor* self = static_cast<API_Resistor*>(arg);
+    for (;;) {
+        // La ventana mide ya con el último pedido aplicado
+        self->update_output();
+        self->sample_window();
+        vTaskDelay(pdMS_TO_TICKS(RESISTOR_ADC_INTERVAL_MS));
+    }
 }
@@ -0,0 +1,132 @@
+#include "API_RunConfig.h"
+#include <stdlib.h>
+#include <string.h>
+
+API_RunConfig::API_RunConfig(float setpoint, uint8_t fixed_percent, uint8_t cooler_percent) {
+  __current.version = 0;
+  __current.mode = RUN_MODE_FIXED;
+  __current.node = RUN_CFG_NODE_MIN;
+  __current.setpoint = setpoint;
+  __current.fixed_percent = fixed_percent;
+  __current.cooler_percent = cooler_percent;
+  __published.publish(__current);
+}
+
+const char* API_RunConfig::validate(const Run_config_patch& patch) {
+  if ((patch.fields & RUN_CFG_MODE) && patch.mode != RUN_MODE_FIXED && patch.mode != RUN_MODE_PID)
+    return "mode pid|fixed";
+  if ((patch.fields & RUN_CFG_NODE) && (patch.node < RUN_CFG_NODE_MIN || patch.node > RUN_CFG_NODE_MAX))
+    return "node out of range";
+  // !(a >= b) también rechaza NaN
+  if ((patch.fields & RUN_CFG_SETPOINT) &&
+      !(patch.setpoint >= RUN_CFG_SETPOINT_MIN && patch.setpoint <= RUN_CFG_SETPOINT_MAX))
+    return "setpoint 5-90C";
+  if ((patch.fields & RUN_CFG_FIXED) && (patch.fixed_percent < 0 || patch.fixed_percent > 100))
+    return "fixed_percent 0-100";
+  if ((patch.fields & RUN_CFG_COOLER) && (patch.cooler_percent < 0 || patch.cooler_percent > 100))
+    return "cooler_percent 0-100";
+  return NULL;
+}
+
+const char* API_RunConfig::apply(const Run_config_patch& patch, Run_config* out) {
+  const char* err = API_RunConfig::validate(patch);
+  if (err) return err;
+  // Sin campos no hay versión nueva
+  if (!patch.fields) { if (out) *out = __current; return NULL; }
+  // Se arma la versión nueva completa y se publica de una vez
+  Run_config next = __current;
+  if (patch.fields & RUN_CFG_MODE) next.mode = (uint8_t)patch.mode;
+  if (patch.fields & RUN_CFG_NODE) next.node = (uint8_t)patch.node;
+  if (patch.fields & RUN_CFG_SETPOINT) next.setpoint = patch.setpoint;
+  if (patch.fields & RUN_CFG_FIXED) next.fixed_percent = (uint8_t)patch.fixed_percent;
+  if (patch.fields & RUN_CFG_COOLER) next.cooler_percent = (uint8_t)patch.cooler_percent;
+  next.version = __current.version + 1;
+  __current = next;
+  __published.publish(next);
+  if (out) *out = next;
+  return NULL;
+}
+
+static const char* skipSpace(const char* p) {
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+  return p;
+}
+
+// Cadena JSON sin escapes (las claves y valores de la config no los usan)
+static const char* parseString(const char* p, char* out, size_t cap) {
+  if (*p != '"') return NULL;
+  p++;
+  size_t n = 0;
+  while (*p && *p != '"') {
+    if (*p == '\\' || n + 1 >= cap) return NULL;
+    out[n++] = *p++;
+  }
+  if (*p != '"') return NULL;
+  out[n] = '\0';
+  return p + 1;
+}
+
+static const char* parseNumber(const char* p, float& out) {
+  char* end;
+  out = strtof(p, &end);
+  return end == p ? NULL : end;
+}
+
+static const char* parseInt(const char* p, int& out) {
+  char* end;
+  long v = strtol(p, &end, 10);
+  // Un entero no puede seguir con parte decimal o exponente
+  if (end == p || *end == '.' || *end == 'e' || *end == 'E') return NULL;
+  if (v < -100000 || v > 100000) v = v < 0 ? -100000 : 100000;
+  out = (int)v;
+  return end;
+}
+
+const char* API_RunConfig::parse(const char* json, Run_config_patch& patch) {
+  patch.fields = 0;
+  const char* p = skipSpace(json);
+  if (*p++ != '{') return "expected JSON object";
+  p = skipSpace(p);
+  if (*p == '}') return skipSpace(p + 1)[0] ? "trailing data" : NULL;
+  for (;;) {
+    char key[24];
+    p = parseString(p, key, sizeof(key));
+    if (!p) return "bad key";
+    p = skipSpace(p);
+    if (*p++ != ':') return "expected ':'";
+    p = skipSpace(p);
+
+    if (!strcmp(key, "mode")) {
+      char v[8];
+      p = parseString(p, v, sizeof(v));
+      if (!p) return "mode pid|fixed";
+      if (!strcmp(v, "pid")) patch.mode = RUN_MODE_PID;
+      else if (!strcmp(v, "fixed")) patch.mode = RUN_MODE_FIXED;
+      else return "mode pid|fixed";
+      patch.fields |= RUN_CFG_MODE;
+    } else if (!strcmp(key, "node")) {
+      p = parseInt(p, patch.node);
+      if (!p) return "node out of range";
+      patch.fields |= RUN_CFG_NODE;
+    } else if (!strcmp(key, "setpoint")) {
+      p = parseNumber(p, patch.setpoint);
+      if (!p) return "setpoint 5-90C";
+      patch.fields |= RUN_CFG_SETPOINT;
+    } else if (!strcmp(key, "fixed_percent")) {
+      p = parseInt(p, patch.fixed_percent);
+      if (!p) return "fixed_percent 0-100";
+      patch.fields |= RUN_CFG_FIXED;
+    } else if (!strcmp(key, "cooler_percent")) {
+      p = parseInt(p, patch.cooler_percent);
+      if (!p) return "cooler_percent 0-100";
+      patch.fields |= RUN_CFG_COOLER;
+    } else {
+      return "unknown key";
+    }
+
+    p = skipSpace(p);
+    if (*p == ',') { p = skipSpace(p + 1); continue; }
+    if (*p != '}') return "expected ',' or '}'";
+    return skipSpace(p + 1)[0] ? "trailing data" : NULL;
+  }
+}
@@ -0,0 +1,52 @@
+#include "API_Sampler.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+API_Sampler::API_Sampler() {
+  __sensors = nullptr;
+  __heater = nullptr;
+}
+
+bool API_Sampler::begin(API_Sensors* sensors, API_Resistor* heater) {
+  __sensors = sensors;
+  __heater = heater;
+  BaseType_t ok = xTaskCreatePinnedToCore(API_Sampler::task, "sampler", SAMPLER_STACK,
+                                          this, SAMPLER_PRIORITY, nullptr, SAMPLER_CORE);
+  if (ok != pdPASS) {
+    Serial.println("[Sampler] No se pudo crear la tarea de muestreo");
+    return false;
+  }
+  return true;
+}
+
+bool API_Sampler::step() {
+  if (!__sensors->poll()) return false;
+
+  const Sensors_sample& s = __sensors->latest();
+  Sample_snapshot snap;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    snap.temps_raw[i] = s.temps_raw[i];
+    snap.resolution[i] = s.resolution[i];
+    snap.health[i] = s.health[i];
+  }
+  if (s.updated_mask & (1UL << SAMPLER_HEATER_NODE)) {
+    __heater->set_temperature(temp_raw_to_c(s.temps_raw[SAMPLER_HEATER_NODE]));
+  }
+  snap.heater_w = __heater->get_heat();
+  snap.timestamp_ms = s.timestamp_ms;
+  snap.seq = s.seq;
+  snap.bus_time_us = s.bus_time_us;
+  __snapshot.publish(snap);
+  return true;
+}
+
+void API_Sampler::task(void* arg) {
+  API_Sampler* self = static_cast<API_Sampler*>(arg);
+  for (;;) {
+    self->step();
+    unsigned long wait_ms = self->__sensors->ms_to_next_event();
+    if (wait_ms > SAMPLER_MAX_SLEEP_MS) wait_ms = SAMPLER_MAX_SLEEP_MS;
+    TickType_t ticks = pdMS_TO_TICKS(wait_ms);
+    vTaskDelay(ticks > 0 ? ticks : 1);
+  }
+}
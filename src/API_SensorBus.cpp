@@ -0,0 +1,293 @@
+#include "API_SensorBus.h"
+
+// Temperatura DS18B20 en 1/16 °C; a menor resolución los bits bajos no
+// están definidos y se descartan
+static Temp_raw maskRaw(uint8_t lsb, uint8_t msb, uint8_t bits) {
+  if (lsb == 0xff && msb == 0xff) return SENSORBUS_DISCONNECTED_RAW;  // nadie respondió
+  Temp_raw raw = (Temp_raw)(((uint16_t)msb << 8) | lsb);
+  if (bits >= 9 && bits < 12) raw &= ~((1 << (12 - bits)) - 1);
+  return raw;
+}
+
+// Scratchpad completo ya leído del bus; crc_ok lo calcula cada backend
+static Sensor_read parseScratchpad(const Sensor_rom rom, const uint8_t sp[9], bool crc_ok, Temp_raw* raw) {
+  bool all_ff = true, all_zero = true;
+  for (int i = 0; i < 9; i++) {
+    if (sp[i] != 0xff) all_ff = false;
+    if (sp[i] != 0x00) all_zero = false;
+  }
+  // Todo 0xff: el sensor no respondió. Todo ceros: bus en corto a masa
+  // (el CRC de ceros es 0, así que pasaría la verificación)
+  if (all_ff || all_zero) return SENSOR_READ_DISCONNECTED;
+  if (!crc_ok) return SENSOR_READ_CRC_ERROR;
+  if (rom[0] == 0x10) {
+    // DS18S20: 0.5 °C por bit, extendido con COUNT_REMAIN/COUNT_PER_C:
+    // T = entero - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C
+    int16_t half = (int16_t)(((uint16_t)sp[1] << 8) | sp[0]);
+    int16_t ext = sp[7] ? (int16_t)((sp[7] - sp[6]) * TEMP_RAW_ONE_C / sp[7]) : TEMP_RAW_ONE_C / 4;
+    *raw = (Temp_raw)((half >> 1) * TEMP_RAW_ONE_C - TEMP_RAW_ONE_C / 4 + ext);
+  } else {
+    // Resolución según el registro de configuración (bits 5-6)
+    *raw = maskRaw(sp[0], sp[1], 9 + ((sp[4] >> 5) & 0x03));
+  }
+  return SENSOR_READ_OK;
+}
+
+#if SENSORS_BACKEND == SENSORS_BACKEND_DSTHERM
+
+/**************************************************************/
+// Backend OneWireNg + DSTherm
+/**************************************************************/
+
+API_SensorBus::API_SensorBus(uint8_t pin) {
+    __ow = new OneWireNg_CurrentPlatform(pin, false);
+    __drv = new DSTherm(*__ow);
+    __search_done = false;
+    __bus_time_us = 0;
+}
+
+void API_SensorBus::begin() {
+  // Sólo DS18B20: el resto de familias se descarta durante la búsqueda
+  __ow->searchFilterAdd(SENSORBUS_FAMILY_DS18B20);
+}
+
+void API_SensorBus::reset_search() {
+  __ow->searchReset();
+  __search_done = false;
+}
+
+bool API_SensorBus::search(Sensor_rom rom) {
+  return API_SensorBus::searchNext(rom, false);
+}
+
+void API_SensorBus::reset_alarm_search() {
+  API_SensorBus::reset_search();
+}
+
+bool API_SensorBus::alarm_search(Sensor_rom rom) {
+  return API_SensorBus::searchNext(rom, true);
+}
+
+bool API_SensorBus::searchNext(Sensor_rom rom, bool alarm) {
+  if (__search_done) return false;
+  unsigned long t0 = micros();
+  OneWireNg::Id id;
+  OneWireNg::ErrorCode ec = __ow->search(id, alarm);
+  __bus_time_us += micros() - t0;
+  // EC_MORE: id válido (aunque sea el último); EC_NO_DEVS u otro código:
+  // búsqueda terminada o error de bus, sin id
+  if (ec != OneWireNg::EC_MORE) { __search_done = true; return false; }
+  memcpy(rom, id, sizeof(Sensor_rom));
+  return true;
+}
+
+bool API_SensorBus::valid_rom(const Sensor_rom rom) {
+  return OneWireNg::crc8(rom, 7) == rom[7] && rom[0] == SENSORBUS_FAMILY_DS18B20;
+}
+
+void API_SensorBus::convert_all() {
+  unsigned long t0 = micros();
+  // maxConvTime = 0: el driver no espera, la espera la planifica API_Sensors
+  __drv->convertTempAll(0, false);
+  __bus_time_us += micros() - t0;
+}
+
+void API_SensorBus::convert(const Sensor_rom rom) {
+  unsigned long t0 = micros();
+  __drv->convertTemp(*reinterpret_cast<const OneWireNg::Id*>(rom), 0, false);
+  __bus_time_us += micros() - t0;
+}
+
+bool API_SensorBus::isConversionComplete() {
+  unsigned long t0 = micros();
+  // Durante la conversión el DS18B20 responde 0 a un read slot
+  bool done = __ow->touchBit(1) != 0;
+  __bus_time_us += micros() - t0;
+  return done;
+}
+
+uint16_t API_SensorBus::millisToWaitForConversion(uint8_t bits) {
+  return bits <= 9 ? 94 : bits == 10 ? 188 : bits == 11 ? 375 : 750;
+}
+
+bool API_SensorBus::setResolution(const Sensor_rom rom, uint8_t bits) {
+  const OneWireNg::Id& id = *reinterpret_cast<const OneWireNg::Id*>(rom);
+  Placeholder<DSTherm::Scratchpad> scrpd;
+  unsigned long t0 = micros();
+  // Conserva TH/TL: sólo cambia el registro de configuración
+  bool ok = __drv->readScratchpad(id, scrpd) == OneWireNg::EC_SUCCESS;
+  if (ok) {
+    const DSTherm::Scratchpad& s = scrpd;
+    ok = __drv->writeScratchpad(id, s.getTh(), s.getTl(),
+                                (DSTherm::Resolution)(bits - 9)) == OneWireNg::EC_SUCCESS;
+  }
+  __bus_time_us += micros() - t0;
+  return ok;
+}
+
+bool API_SensorBus::setAlarms(const Sensor_rom rom, int8_t th, int8_t tl, uint8_t bits) {
+  unsigned long t0 = micros();
+  bool ok = __drv->writeScratchpad(*reinterpret_cast<const OneWireNg::Id*>(rom), th, tl,
+                                   (DSTherm::Resolution)(bits - 9)) == OneWireNg::EC_SUCCESS;
+  __bus_time_us += micros() - t0;
+  return ok;
+}
+
+Sensor_read API_SensorBus::readTemp(const Sensor_rom rom, Temp_raw* raw) {
+  uint8_t sp[9];
+  unsigned long t0 = micros();
+  // Lectura cruda en lugar de DSTherm::readScratchpad(): el driver reporta
+  // igual un CRC malo y un sensor ausente (0xff), y la salud los distingue.
+  // addressSingle() ya hace el reset y devuelve la presencia
+  bool present = __ow->addressSingle(*reinterpret_cast<const OneWireNg::Id*>(rom)) == OneWireNg::EC_SUCCESS;
+  if (present) {
+    __ow->writeByte(SENSORBUS_READ_SCRATCHPAD);
+    for (int i = 0; i < 9; i++) sp[i] = __ow->readByte();
+  }
+  __bus_time_us += micros() - t0;
+  if (!present) return SENSOR_READ_DISCONNECTED;
+  return parseScratchpad(rom, sp, OneWireNg::crc8(sp, 8) == sp[8], raw);
+}
+
+Temp_raw API_SensorBus::readTempFast(const Sensor_rom rom, uint8_t bits) {
+  unsigned long t0 = micros();
+  if (__ow->addressSingle(*reinterpret_cast<const OneWireNg::Id*>(rom)) != OneWireNg::EC_SUCCESS) {
+    __bus_time_us += micros() - t0;
+    return SENSORBUS_DISCONNECTED_RAW;
+  }
+  __ow->writeByte(SENSORBUS_READ_SCRATCHPAD);
+  uint8_t lsb = __ow->readByte();
+  uint8_t msb = __ow->readByte();
+  // Corta la transferencia: no se leen los 7 bytes restantes ni el CRC
+  __ow->reset();
+  __bus_time_us += micros() - t0;
+  return maskRaw(lsb, msb, bits);
+}
+
+#else
+
+/**************************************************************/
+// Backend OneWire + DallasTemperature
+/**************************************************************/
+
+API_SensorBus::API_SensorBus(uint8_t pin) {
+    __oneWire = new OneWire(pin);
+    __sensors = new DallasTemperature(__oneWire);
+    __bus_time_us = 0;
+}
+
+void API_SensorBus::begin() {
+  // Start up the library
+  __sensors->begin();
+  // requestTemperatures() no bloquea; la espera la planifica API_Sensors
+  __sensors->setWaitForConversion(false);
+  // Los cambios de resolución son frecuentes: no gastar la EEPROM del sensor
+  __sensors->setAutoSaveScratchPad(false);
+}
+
+void API_SensorBus::reset_search() {
+  __oneWire->reset_search();
+}
+
+bool API_SensorBus::search(Sensor_rom rom) {
+  unsigned long t0 = micros();
+  bool found = __oneWire->search(rom);
+  __bus_time_us += micros() - t0;
+  return found;
+}
+
+bool API_SensorBus::valid_rom(const Sensor_rom rom) {
+  return __sensors->validAddress(rom) && __sensors->validFamily(rom);
+}
+
+void API_SensorBus::reset_alarm_search() {
+  __oneWire->reset_search();
+}
+
+bool API_SensorBus::alarm_search(Sensor_rom rom) {
+  unsigned long t0 = micros();
+  bool found = __oneWire->search(rom, false);   // false: ALARM SEARCH (0xEC)
+  __bus_time_us += micros() - t0;
+  return found;
+}
+
+void API_SensorBus::convert_all() {
+  unsigned long t0 = micros();
+  __sensors->requestTemperatures();   // retorna sin esperar
+  __bus_time_us += micros() - t0;
+}
+
+void API_SensorBus::convert(const Sensor_rom rom) {
+  unsigned long t0 = micros();
+  __sensors->requestTemperaturesByAddress(rom);
+  __bus_time_us += micros() - t0;
+}
+
+bool API_SensorBus::isConversionComplete() {
+  unsigned long t0 = micros();
+  bool done = __sensors->isConversionComplete();
+  __bus_time_us += micros() - t0;
+  return done;
+}
+
+uint16_t API_SensorBus::millisToWaitForConversion(uint8_t bits) {
+  return __sensors->millisToWaitForConversion(bits);
+}
+
+bool API_SensorBus::setResolution(const Sensor_rom rom, uint8_t bits) {
+  unsigned long t0 = micros();
+  bool ok = __sensors->setResolution(rom, bits);
+  __bus_time_us += micros() - t0;
+  return ok;
+}
+
+bool API_SensorBus::setAlarms(const Sensor_rom rom, int8_t th, int8_t tl, uint8_t bits) {
+  unsigned long t0 = micros();
+  // Una sola escritura de scratchpad, en lugar de setHighAlarmTemp() y
+  // setLowAlarmTemp() que leen y reescriben el scratchpad cada una
+  bool ok = __oneWire->reset();
+  if (ok) {
+    __oneWire->select(rom);
+    __oneWire->write(SENSORBUS_WRITE_SCRATCHPAD);
+    __oneWire->write((uint8_t)th);
+    __oneWire->write((uint8_t)tl);
+    // El DS18S20 no tiene registro de configuración
+    if (rom[0] != 0x10) __oneWire->write((uint8_t)(((bits - 9) << 5) | 0x1f));
+  }
+  __bus_time_us += micros() - t0;
+  return ok;
+}
+
+Sensor_read API_SensorBus::readTemp(const Sensor_rom rom, Temp_raw* raw) {
+  uint8_t sp[9];
+  unsigned long t0 = micros();
+  // Lectura cruda en lugar de getTempC(), que devuelve -127 tanto para un
+  // CRC malo como para un sensor ausente
+  bool present = __oneWire->reset();
+  if (present) {
+    __oneWire->select(rom);
+    __oneWire->write(SENSORBUS_READ_SCRATCHPAD);
+    for (int i = 0; i < 9; i++) sp[i] = __oneWire->read();
+  }
+  __bus_time_us += micros() - t0;
+  if (!present) return SENSOR_READ_DISCONNECTED;
+  return parseScratchpad(rom, sp, OneWire::crc8(sp, 8) == sp[8], raw);
+}
+
+Temp_raw API_SensorBus::readTempFast(const Sensor_rom rom, uint8_t bits) {
+  unsigned long t0 = micros();
+  if (!__oneWire->reset()) {
+    __bus_time_us += micros() - t0;
+    return SENSORBUS_DISCONNECTED_RAW;
+  }
+  __oneWire->select(rom);
+  __oneWire->write(SENSORBUS_READ_SCRATCHPAD);
+  uint8_t lsb = __oneWire->read();
+  uint8_t msb = __oneWire->read();
+  // Corta la transferencia: no se leen los 7 bytes restantes ni el CRC
+  __oneWire->reset();
+  __bus_time_us += micros() - t0;
+  return maskRaw(lsb, msb, bits);
+}
+
+#endif
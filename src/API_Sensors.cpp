@@ -1,19 +1,107 @@
 #include "API_Sensors.h"
+#include <Preferences.h>
+
+static const uint8_t bus_pins[SENSORS_BUS_COUNT] = SENSORS_BUS_PINS;
+
+// Umbrales en 1/16 °C
+static const Temp_raw fast_max_jump = (Temp_raw)(SENSORS_FAST_MAX_JUMP * TEMP_RAW_ONE_C);
+static const Temp_raw min_valid = (Temp_raw)(SENSORS_MIN_VALID_C * TEMP_RAW_ONE_C);
+
+// Formato del mapa en NVS; rom en ceros = rol sin asignar
+struct Sensors_map_blob{
+      uint8_t version;
+      uint8_t count;
+      uint8_t rom[DEVICES_CONNECT][8];
+      uint8_t bus[DEVICES_CONNECT];
+    };
 
 
 API_Sensors::API_Sensors() {
-    __oneWire = new OneWire(ONE_WIRE_BUS);
-    __sensors = new DallasTemperature(__oneWire);
-    DeviceAddress __tempDeviceAddress;
+    for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+      __bus[b] = new API_SensorBus(bus_pins[b]);
+      __bus_devices[b] = 0;
+      __acq_wait_ms[b] = 0;
+    }
+    __numberOfDevices = 0;
+    for (int i = 0; i < DEVICES_CONNECT; i++) {
+      __rom_valid[i] = false;
+      __rom_bus[i] = 0;
+      __read_order[i] = i;
+      __temperature_data[i] = 0;
+      __fast_count[i] = SENSORS_FULL_READ_EVERY;   // primera lectura: completa
+      __health[i] = Sensor_health();
+      __same_count[i] = 0;
+      __latest.health[i] = __health[i];
+      __alarm_set[i] = false;
+      __latest.temps_raw[i] = 0;
+      __resolution[i] = 0;
+      __resolution_target[i] = SENSORS_RES_DEFAULT;
+      __latest.resolution[i] = SENSORS_RES_DEFAULT;
+    }
+    __latest.timestamp_ms = 0;
+    __latest.seq = 0;
+    __latest.updated_mask = 0;
+    __latest.bus_time_us = 0;
+    __acq_state = ACQ_IDLE;
+    __acq_mask = 0;
+    __acq_read = 0;
+    __acq_pending = 0;
+    __acq_start_ms = 0;
+    __acq_bus_us = 0;
+    __control_start_ms = 0;
+    __aux_start_ms = 0;
+    __control_period_ms = SENSORS_CONTROL_PERIOD;
+    __aux_period_ms = SENSORS_AUX_PERIOD;
+    __control_node = SENSORS_CONTROL_NODE;
+    __adaptive_res = SENSORS_ADAPTIVE_RES;
+    __fast_read = SENSORS_FAST_READ;
+    __monitor_request = false;
+    __monitor = false;
+    __monitor_cycles = 0;
+    __verify_pending = false;
+    __map_verified = false;
+    __map_missing = 0;
+    __unknown_count = 0;
+    __remap_request = REMAP_NONE;
+    __remap_role = 0;
+    __full_every = SENSORS_FULL_READ_EVERY;
+    __res_transient = SENSORS_RES_TRANSIENT;
+    __res_steady = SENSORS_RES_DEFAULT;
+    __transient_rate = SENSORS_TRANSIENT_RATE;
+    __in_transient = false;
+    __control_prev_node = SENSORS_CONTROL_NODE;
+    __control_prev_temp = 0;
+    __control_prev_ms = 0;
+    API_Sensors::publishMap();
     // Diferir init hasta después de Serial.begin() en setup()
 }
 
 void API_Sensors::init(bool print_init){
-  // Start up the library
-  __sensors->begin();
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) __bus[b]->begin();
 
-  // Grab a count of devices on the wire
-  __numberOfDevices = __sensors->getDeviceCount();
+  if (SENSORS_USE_NVS_MAP && API_Sensors::loadMap()) {
+    // Roles conocidos: se direccionan sin buscar; la verificación contra
+    // el bus queda para poll()
+    __verify_pending = true;
+    if(print_init){
+      for (int i = 0; i < DEVICES_CONNECT; i++) {
+        if (!__rom_valid[i]) continue;
+        Serial.print("Mapped device ");
+        Serial.print(i, DEC);
+        Serial.print(" on bus ");
+        Serial.print(__rom_bus[i], DEC);
+        Serial.print(" with address: ");
+        API_Sensors::printAddress(__rom_table[i]);
+        Serial.println();
+      }
+    }
+  } else {
+    // Sin mapa: una sola búsqueda completa por bus y el orden encontrado
+    // queda guardado como mapa
+    API_Sensors::rescan(print_init);
+    if (SENSORS_USE_NVS_MAP && __numberOfDevices > 0) API_Sensors::saveMap();
+  }
+  API_Sensors::applyResolutions();
 
   // Si el conteo no coincide, informar pero no reiniciar aquí
   if(__numberOfDevices!=DEVICES_CONNECT){
@@ -22,65 +110,664 @@ void API_Sensors::init(bool print_init){
     Serial.print(" detectados: ");
     Serial.println(__numberOfDevices);
   }
-  
-  if(print_init){
-  // locate devices on the bus
-  Serial.print("Locating devices...");
-  Serial.print("Found ");
-  Serial.print(__numberOfDevices, DEC);
-  Serial.println(" devices.");  
-    
-  // Loop through each device, print out address
-  for(int i=0;i<__numberOfDevices; i++){
-    // Search the wire for address
-    if(__sensors->getAddress(__tempDeviceAddress, i)){
-      Serial.print("Found device ");
-      Serial.print(i, DEC);
-      Serial.print(" with address: ");
-      API_Sensors::printAddress(__tempDeviceAddress);
-      Serial.println();
-      } else {
-      Serial.print("Found ghost device at ");
-      Serial.print(i, DEC);
-      Serial.print(" but could not detect address. Check power and cabling");
+}
+
+int API_Sensors::rescan(bool print_scan){
+  Sensor_rom addr;
+  int idx = 0;
+
+  if(print_scan){
+    Serial.println("Locating devices...");
+  }
+
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+    // Recorre el bus una única vez (search incremental), en lugar de
+    // getAddress(i) que reinicia la búsqueda para cada índice
+    __bus[b]->reset_search();
+    while (idx < DEVICES_CONNECT && __bus[b]->search(addr)) {
+      if (!__bus[b]->valid_rom(addr)) {
+        if(print_scan){
+          Serial.print("Found ghost device at ");
+          Serial.print(idx, DEC);
+          Serial.println(" but could not validate address. Check power and cabling");
+        }
+        continue;
+      }
+      memcpy(__rom_table[idx], addr, sizeof(Sensor_rom));
+      __rom_valid[idx] = true;
+      __rom_bus[idx] = b;
+      if(print_scan){
+        Serial.print("Found device ");
+        Serial.print(idx, DEC);
+        Serial.print(" on bus ");
+        Serial.print(b, DEC);
+        Serial.print(" with address: ");
+        API_Sensors::printAddress(addr);
+        Serial.println();
+      }
+      idx++;
+    }
+  }
+  for (int i = idx; i < DEVICES_CONNECT; i++) __rom_valid[i] = false;
+  API_Sensors::indexTable();
+  // La búsqueda recién hecha ya es la verificación
+  __verify_pending = false;
+  __map_verified = true;
+  __map_missing = 0;
+  __unknown_count = 0;
+  API_Sensors::publishMap();
+
+  if(print_scan){
+    Serial.print("Found ");
+    Serial.print(__numberOfDevices, DEC);
+    Serial.println(" devices.");
+  }
+  return __numberOfDevices;
+}
+
+void API_Sensors::indexTable(){
+  __numberOfDevices = 0;
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) __bus_devices[b] = 0;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if (!__rom_valid[i]) continue;
+    __bus_devices[__rom_bus[i]] |= 1UL << i;
+    __numberOfDevices++;
+  }
+
+  // Orden intercalado: el k-ésimo sensor de cada bus, bus por bus
+  int n = 0;
+  for (int k = 0; n < __numberOfDevices; k++) {
+    for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+      int seen = 0;
+      for (int i = 0; i < DEVICES_CONNECT; i++) {
+        if (!(__bus_devices[b] & (1UL << i))) continue;
+        if (seen++ == k) { __read_order[n++] = i; break; }
+      }
+    }
+  }
+
+  // Los índices pueden haber cambiado de sensor: la salud empieza de cero
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    __health[i] = Sensor_health();
+    __same_count[i] = 0;
+    __alarm_set[i] = false;
+    __fast_count[i] = SENSORS_FULL_READ_EVERY;
+  }
+  API_Sensors::publishMap();
+}
+
+int API_Sensors::findRole(const Sensor_rom rom){
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if (__rom_valid[i] && memcmp(rom, __rom_table[i], sizeof(Sensor_rom)) == 0) return i;
+  }
+  return -1;
+}
+
+bool API_Sensors::loadMap(){
+  Sensors_map_blob blob;
+  Preferences prefs;
+  if (!prefs.begin(SENSORS_MAP_NAMESPACE, true)) return false;
+  size_t len = prefs.getBytes("map", &blob, sizeof(blob));
+  prefs.end();
+  if (len != sizeof(blob) || blob.version != SENSORS_MAP_VERSION || blob.count != DEVICES_CONNECT) return false;
+
+  bool any = false;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    __rom_valid[i] = false;
+    if (blob.bus[i] >= SENSORS_BUS_COUNT || !__bus[blob.bus[i]]->valid_rom(blob.rom[i])) continue;
+    memcpy(__rom_table[i], blob.rom[i], sizeof(Sensor_rom));
+    __rom_bus[i] = blob.bus[i];
+    __rom_valid[i] = true;
+    any = true;
+  }
+  if (!any) return false;
+  API_Sensors::indexTable();
+  return true;
+}
+
+bool API_Sensors::saveMap(){
+  Sensors_map_blob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.version = SENSORS_MAP_VERSION;
+  blob.count = DEVICES_CONNECT;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if (!__rom_valid[i]) continue;
+    memcpy(blob.rom[i], __rom_table[i], sizeof(Sensor_rom));
+    blob.bus[i] = __rom_bus[i];
+  }
+  Preferences prefs;
+  if (!prefs.begin(SENSORS_MAP_NAMESPACE, false)) return false;
+  bool ok = prefs.putBytes("map", &blob, sizeof(blob)) == sizeof(blob);
+  prefs.end();
+  return ok;
+}
+
+bool API_Sensors::verifyMap(){
+  Sensor_rom addr;
+  uint32_t seen = 0;
+  bool moved = false;
+  int unknown = 0;
+
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+    __bus[b]->reset_search();
+    while (__bus[b]->search(addr)) {
+      if (!__bus[b]->valid_rom(addr)) continue;
+      int role = API_Sensors::findRole(addr);
+      if (role < 0) {
+        if (unknown < DEVICES_CONNECT) {
+          memcpy(__unknown[unknown], addr, sizeof(Sensor_rom));
+          __unknown_bus[unknown++] = b;
+        }
+        continue;
       }
-    }    
+      seen |= 1UL << role;
+      // Sensor conocido cambiado de bus: se corrige sin cambiar su rol
+      if (__rom_bus[role] != b) { __rom_bus[role] = b; moved = true; }
+    }
+  }
+  if (moved) {
+    API_Sensors::indexTable();
+    API_Sensors::saveMap();
   }
 
+  uint32_t mapped = 0;
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) mapped |= __bus_devices[b];
+  __unknown_count = unknown;
+  __map_missing = mapped & ~seen;
+  __map_verified = true;
+  __verify_pending = false;
+  API_Sensors::publishMap();
+
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if (!(__map_missing & (1UL << i))) continue;
+    Serial.print("[Sensors] Mapa: rol "); Serial.print(i);
+    Serial.print(" ausente, addr="); API_Sensors::printAddress(__rom_table[i]);
+    Serial.println();
+  }
+  for (int k = 0; k < __unknown_count; k++) {
+    Serial.print("[Sensors] Mapa: sensor sin rol en bus "); Serial.print(__unknown_bus[k]);
+    Serial.print(", addr="); API_Sensors::printAddress(__unknown[k]);
+    Serial.println();
+  }
+  return __map_missing == 0 && __unknown_count == 0;
+}
+
+bool API_Sensors::set_role(uint8_t role, const Sensor_rom rom){
+  // CRC y familia; el bus real se resuelve al aplicar
+  if (role >= DEVICES_CONNECT || !__bus[0]->valid_rom(rom)) return false;
+  memcpy(__remap_rom, rom, sizeof(Sensor_rom));
+  __remap_role = role;
+  __remap_request = REMAP_ROLE;
+  return true;
+}
+
+void API_Sensors::applyRemap(){
+  if (__remap_request == REMAP_REBUILD) {
+    API_Sensors::rescan(false);
+    API_Sensors::saveMap();
+    __remap_request = REMAP_NONE;
+    return;
+  }
+
+  // Buses y ROMs sin rol actuales
+  API_Sensors::verifyMap();
+  uint8_t role = __remap_role;
+  int from = API_Sensors::findRole(__remap_rom);
+  if (from < 0) {
+    int u = -1;
+    for (int k = 0; k < __unknown_count; k++) {
+      if (memcmp(__unknown[k], __remap_rom, sizeof(Sensor_rom)) == 0) { u = k; break; }
+    }
+    if (u < 0) {
+      Serial.println("[Sensors] Mapa: la ROM pedida no está en ningún bus");
+      __remap_request = REMAP_NONE;
+      return;
+    }
+    // El sensor anterior del rol (si lo había) queda sin rol
+    memcpy(__rom_table[role], __unknown[u], sizeof(Sensor_rom));
+    __rom_bus[role] = __unknown_bus[u];
+    __rom_valid[role] = true;
+  } else if (from != role) {
+    // Intercambio de roles
+    Sensor_rom tmp;
+    uint8_t tmp_bus = __rom_bus[role];
+    bool tmp_valid = __rom_valid[role];
+    memcpy(tmp, __rom_table[role], sizeof(Sensor_rom));
+    memcpy(__rom_table[role], __rom_table[from], sizeof(Sensor_rom));
+    __rom_bus[role] = __rom_bus[from];
+    __rom_valid[role] = true;
+    memcpy(__rom_table[from], tmp, sizeof(Sensor_rom));
+    __rom_bus[from] = tmp_bus;
+    __rom_valid[from] = tmp_valid;
+    __resolution[from] = 0;
+  }
+  // Resolución del sensor desconocida: applyResolutions() la reescribe
+  __resolution[role] = 0;
+  API_Sensors::indexTable();
+  API_Sensors::saveMap();
+  __verify_pending = true;
+  __remap_request = REMAP_NONE;
+}
+
+bool API_Sensors::get_rom(uint8_t role, Sensor_rom rom){
+  if (role >= DEVICES_CONNECT) return false;
+  Sensors_map m = __map.read();
+  if (m.bus[role] < 0) return false;
+  memcpy(rom, m.rom[role], sizeof(Sensor_rom));
+  return true;
+}
+
+bool API_Sensors::get_unknown(int k, Sensor_rom rom, int* bus){
+  Sensors_map m = __map.read();
+  if (k < 0 || k >= m.unknown_count) return false;
+  memcpy(rom, m.unknown[k], sizeof(Sensor_rom));
+  *bus = m.unknown_bus[k];
+  return true;
+}
+
+// Copia las tablas del mapa al snapshot; sólo desde la tarea de poll()
+// (o antes de lanzarla), único escritor de las tablas
+void API_Sensors::publishMap(){
+  Sensors_map m;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    memcpy(m.rom[i], __rom_table[i], sizeof(Sensor_rom));
+    m.bus[i] = __rom_valid[i] ? (int8_t)__rom_bus[i] : -1;
+  }
+  m.verified = __map_verified;
+  m.missing = __map_missing;
+  m.unknown_count = (uint8_t)__unknown_count;
+  for (int k = 0; k < __unknown_count; k++) {
+    memcpy(m.unknown[k], __unknown[k], sizeof(Sensor_rom));
+    m.unknown_bus[k] = __unknown_bus[k];
+  }
+  __map.publish(m);
 }
 
 
 void API_Sensors::getTemperatures(float write_data[DEVICES_CONNECT]){
-  float tempC;
-  Serial.println("[Sensors] getTemperatures() called");
-  __sensors->requestTemperatures(); // Send the command to get temperatures
+  // Lectura bloqueante: convierte en todos los buses a la vez y espera
+  uint32_t all = (1UL << DEVICES_CONNECT) - 1;
+  API_Sensors::startConversion(all);
+  API_Sensors::waitConversion();
+  // La conversión pendiente de poll() (si la había) queda cubierta por esta
+  __acq_state = ACQ_IDLE;
 
-  // Loop through each device, print out temperature data
+  API_Sensors::readSensors(all, SENSORS_VERBOSE);
+  API_Sensors::publish(all);
   for (int i = 0; i < DEVICES_CONNECT; i++) {
-    // Search the wire for address
-    if (__sensors->getAddress(__tempDeviceAddress, i)) {
-      tempC = __sensors->getTempC(__tempDeviceAddress);
-      Serial.print("[Sensors] idx "); Serial.print(i);
-      Serial.print(" addr="); API_Sensors::printAddress(__tempDeviceAddress);
-      Serial.print(" temp="); Serial.println(tempC);
-      if (tempC>5) { __temperature_data[i] = tempC; }
+    // Always reflect current cached value to output buffer
+    write_data[i] = temp_raw_to_c(__temperature_data[i]);
+  }
+}
+
+bool API_Sensors::poll(){
+  unsigned long now = millis();
+
+  switch (__acq_state) {
+    case ACQ_IDLE: {
+      // Reasignación de roles pedida por la API, con el bus libre
+      if (__remap_request != REMAP_NONE) API_Sensors::applyRemap();
+      uint8_t ctrl = __control_node;
+      bool monitor = __monitor_request;
+      if (monitor != __monitor) {
+        // Los umbrales que hubiera no corresponden a los últimos valores
+        for (int i = 0; i < DEVICES_CONNECT; i++) __alarm_set[i] = false;
+        __monitor = monitor;
+        __monitor_cycles = 0;
+      }
+      bool aux_due = __latest.seq == 0 || now - __aux_start_ms >= __aux_period_ms;
+      // En monitoreo el nodo de control no tiene tasa propia
+      bool ctrl_due = !__monitor && ctrl < DEVICES_CONNECT && __rom_valid[ctrl] &&
+                      now - __control_start_ms >= __control_period_ms;
+      if (!aux_due && !ctrl_due) {
+        // Verificación del mapa de arranque en un hueco sin conversiones
+        if (__verify_pending && __latest.seq != 0) API_Sensors::verifyMap();
+        return false;
+      }
+
+      // Cambios de resolución pendientes, con el bus libre
+      API_Sensors::applyResolutions();
+
+      if (aux_due) {
+        if (__monitor && ++__monitor_cycles >= SENSORS_MONITOR_REFRESH) {
+          // Refresco: sin umbrales vigentes se leen todos
+          __monitor_cycles = 0;
+          for (int i = 0; i < DEVICES_CONNECT; i++) __alarm_set[i] = false;
+        }
+        // Conversión de todos los buses (incluye al nodo de control)
+        API_Sensors::startConversion((1UL << DEVICES_CONNECT) - 1);
+        __aux_start_ms = now;
+        __control_start_ms = now;
+      } else {
+        API_Sensors::startConversion(1UL << ctrl);
+        __control_start_ms = now;
+      }
+      __acq_state = ACQ_CONVERTING;
+      return false;
+    }
+
+    case ACQ_CONVERTING: {
+      unsigned long elapsed = now - __acq_start_ms;
+      uint32_t ready = 0;
+      uint32_t mask = 0;
+      for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+        if ((__acq_pending & (1UL << b)) && API_Sensors::busDone(b, elapsed)) {
+          ready |= 1UL << b;
+          mask |= __acq_mask & __bus_devices[b];
+        }
+      }
+      if (!ready) return false;
+      // En monitoreo sólo se leen los sensores que dispararon su alarma
+      if (__monitor) mask = API_Sensors::alarmedSensors(ready, mask);
+      // Cada bus se lee apenas termina, sin esperar al más lento
+      API_Sensors::readSensors(mask, false);
+      if (__monitor) API_Sensors::armAlarms(mask);
+      __acq_read |= mask;
+      __acq_pending &= ~ready;
+      if (__acq_pending) return false;
+
+      API_Sensors::publish(__acq_read);
+      if (__acq_read & (1UL << __control_node)) API_Sensors::updateTransient();
+      __acq_state = ACQ_IDLE;
+      return true;
+    }
+  }
+  return false;
+}
+
+void API_Sensors::startConversion(uint32_t mask){
+  mask &= (1UL << DEVICES_CONNECT) - 1;
+  __acq_mask = mask;
+  __acq_read = 0;
+  __acq_pending = 0;
+  __acq_start_ms = millis();
+  __acq_bus_us = API_Sensors::busTimeUs();
+  // Se lanza en todos los buses antes de esperar: convierten en paralelo
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+    uint32_t bus_mask = mask & __bus_devices[b];
+    if (!bus_mask) continue;
+    if (bus_mask == __bus_devices[b]) {
+      __bus[b]->convert_all();   // retorna sin esperar
     } else {
+      for (int i = 0; i < DEVICES_CONNECT; i++) {
+        if (bus_mask & (1UL << i)) __bus[b]->convert(__rom_table[i]);
+      }
+    }
+    __acq_wait_ms[b] = API_Sensors::planConversion(b, bus_mask);
+    __acq_pending |= 1UL << b;
+  }
+}
+
+bool API_Sensors::busDone(int bus, unsigned long elapsed){
+  unsigned long wait = __acq_wait_ms[bus];
+  // No ocupar el bus consultando antes del último cuarto de la ventana
+  // planificada; en alimentación parásita isConversionComplete() no es
+  // fiable y manda el plazo según la resolución
+  if (elapsed < wait - wait / 4) return false;
+  if (elapsed >= wait) return true;
+  return __bus[bus]->isConversionComplete();
+}
+
+void API_Sensors::waitConversion(){
+  while (__acq_pending) {
+    unsigned long elapsed = millis() - __acq_start_ms;
+    for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+      if ((__acq_pending & (1UL << b)) && API_Sensors::busDone(b, elapsed)) __acq_pending &= ~(1UL << b);
+    }
+    if (__acq_pending) delay(1);
+  }
+}
+
+unsigned long API_Sensors::planConversion(int bus, uint32_t mask){
+  // La conversión del bus termina cuando termina su sensor más lento incluido
+  uint8_t bits = 9;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if ((mask & (1UL << i)) && __resolution[i] > bits) bits = __resolution[i];
+  }
+  return __bus[bus]->millisToWaitForConversion(bits);
+}
+
+unsigned long API_Sensors::ms_to_next_event(){
+  unsigned long now = millis();
+  if (__acq_state == ACQ_CONVERTING) {
+    unsigned long elapsed = now - __acq_start_ms;
+    unsigned long next = __acq_wait_ms[0];
+    for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+      if (!(__acq_pending & (1UL << b))) continue;
+      unsigned long check = __acq_wait_ms[b] - __acq_wait_ms[b] / 4;
+      unsigned long left = elapsed < check ? check - elapsed : 0;
+      if (left < next) next = left;
+    }
+    return next;
+  }
+  if (__latest.seq == 0) return 0;
+  unsigned long aux_left = now - __aux_start_ms >= __aux_period_ms ? 0 : __aux_period_ms - (now - __aux_start_ms);
+  if (__monitor) return aux_left;
+  unsigned long ctrl_left = now - __control_start_ms >= __control_period_ms ? 0 : __control_period_ms - (now - __control_start_ms);
+  return aux_left < ctrl_left ? aux_left : ctrl_left;
+}
+
+bool API_Sensors::set_resolution(uint8_t id_sensor, uint8_t bits){
+  if (id_sensor >= DEVICES_CONNECT || bits < 9 || bits > 12) return false;
+  __resolution_target[id_sensor] = bits;
+  return true;
+}
+
+void API_Sensors::set_control_resolution(uint8_t transient_bits, uint8_t steady_bits, float transient_rate){
+  if (transient_bits >= 9 && transient_bits <= 12) __res_transient = transient_bits;
+  if (steady_bits >= 9 && steady_bits <= 12) __res_steady = steady_bits;
+  if (transient_rate > 0) __transient_rate = transient_rate;
+}
+
+void API_Sensors::applyResolutions(){
+  uint8_t ctrl = __control_node;
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    uint8_t bits = __resolution_target[i];
+    if (__adaptive_res && i == ctrl) bits = __in_transient ? __res_transient : __res_steady;
+    if (!__rom_valid[i] || bits == __resolution[i]) continue;
+    if (__bus[__rom_bus[i]]->setResolution(__rom_table[i], bits)) __resolution[i] = bits;
+  }
+  for (int i = 0; i < DEVICES_CONNECT; i++) __latest.resolution[i] = __resolution[i];
+}
+
+void API_Sensors::updateTransient(){
+  uint8_t ctrl = __control_node;
+  Temp_raw t = __temperature_data[ctrl];
+  unsigned long now = __latest.timestamp_ms;
+  if (ctrl != __control_prev_node) {
+    // Cambió el nodo de control: la pendiente anterior no aplica
+    __control_prev_node = ctrl;
+    __control_prev_ms = 0;
+    __in_transient = false;
+  }
+  if (__control_prev_ms != 0 && now > __control_prev_ms) {
+    // °C/s a partir de la diferencia entera
+    float rate = abs(t - __control_prev_temp) * (1000.0f / TEMP_RAW_ONE_C) / (now - __control_prev_ms);
+    // Histéresis: entra con la tasa umbral, sale con la mitad
+    if (rate > __transient_rate) __in_transient = true;
+    else if (rate < __transient_rate / 2) __in_transient = false;
+  }
+  __control_prev_temp = t;
+  __control_prev_ms = now;
+}
+
+void API_Sensors::readSensors(uint32_t mask, bool verbose){
+  Temp_raw raw;
+
+  // Loop through each device, print out temperature data
+  for (int k = 0; k < __numberOfDevices; k++) {
+    int i = __read_order[k];
+    if (!(mask & (1UL << i))) continue;
+    // Sensor en falla: se saltea sin tocar el bus hasta agotar el backoff
+    if (__health[i].backoff > 0) {
+      __health[i].backoff--;
+      continue;
+    }
+    // Direcciona la ROM cacheada, sin volver a buscar en el bus
+    bool ok = API_Sensors::readSensor(i, &raw);
+    if (verbose) {
+      Serial.print("[Sensors] idx "); Serial.print(i);
+      Serial.print(" addr="); API_Sensors::printAddress(__rom_table[i]);
+      if (ok) { char buf[TEMP_RAW_TEXT_MAX]; temp_raw_format(buf, raw); Serial.print(" temp="); Serial.println(buf); }
+      else { Serial.print(" read failed x"); Serial.println(__health[i].failures); }
+    }
+    // Una lectura fallida conserva el último valor válido
+    if (ok) { __temperature_data[i] = raw; }
+  }
+  if (verbose) {
+    for (int i = 0; i < DEVICES_CONNECT; i++) {
+      if (__rom_valid[i] || !(mask & (1UL << i))) continue;
       Serial.print("[Sensors] idx "); Serial.print(i);
       Serial.println(" no address detected");
     }
-    // Always reflect current cached value to output buffer
-    write_data[i] = __temperature_data[i];
   }
 }
 
+bool API_Sensors::readSensor(int id_sensor, Temp_raw* raw){
+  API_SensorBus* bus = __bus[__rom_bus[id_sensor]];
+  const uint8_t* rom = __rom_table[id_sensor];
+  Sensor_health& h = __health[id_sensor];
+  bool fast = false;
+
+  // DS18S20 (0x10) usa otro formato de temperatura: siempre lectura completa.
+  // Un sensor con fallas recientes también se verifica con CRC
+  if (__fast_read && h.failures == 0 && __fast_count[id_sensor] + 1 < __full_every && rom[0] != 0x10) {
+    Temp_raw t = bus->readTempFast(rom, __resolution[id_sensor]);
+    // Sin CRC: sólo se acepta si es plausible respecto del último valor
+    // válido (85 °C es el valor de encendido del DS18B20)
+    if (t != SENSORBUS_DISCONNECTED_RAW && t != TEMP_RAW_POWER_ON &&
+        abs(t - __temperature_data[id_sensor]) <= fast_max_jump) {
+      __fast_count[id_sensor]++;
+      *raw = t;
+      fast = true;
+    }
+  }
+
+  if (!fast) {
+    __fast_count[id_sensor] = 0;
+    Sensor_read r = bus->readTemp(rom, raw);
+    bool failed = true;
+    if (r == SENSOR_READ_DISCONNECTED) {
+      h.disconnects++;
+    } else if (r == SENSOR_READ_CRC_ERROR) {
+      h.crc_errors++;
+    } else if (*raw == TEMP_RAW_POWER_ON &&
+               (h.last_good_ms == 0 || abs(TEMP_RAW_POWER_ON - __temperature_data[id_sensor]) > fast_max_jump)) {
+      // Reinicio por alimentación: perdió la conversión y la resolución
+      // (sin autosave vuelve a la de EEPROM); applyResolutions() la reescribe
+      h.power_on_resets++;
+      __resolution[id_sensor] = 0;
+      __alarm_set[id_sensor] = false;   // TH/TL también vuelven a los de EEPROM
+    } else if (*raw < min_valid) {
+      h.out_of_range++;
+    } else {
+      failed = false;
+    }
+    if (failed) {
+      API_Sensors::readFailed(id_sensor);
+      return false;
+    }
+  }
+
+  // Valor trabado: se cuenta una vez por racha, no invalida la lectura
+  if (h.last_good_ms != 0 && *raw == __temperature_data[id_sensor]) {
+    if (__same_count[id_sensor] < 0xffff && ++__same_count[id_sensor] == SENSORS_STUCK_READS) h.stuck++;
+  } else {
+    __same_count[id_sensor] = 0;
+  }
+  h.failures = 0;
+  h.last_good_ms = millis();
+  return true;
+}
+
+void API_Sensors::readFailed(int id_sensor){
+  Sensor_health& h = __health[id_sensor];
+  if (h.failures < 0xff) h.failures++;
+  __same_count[id_sensor] = 0;
+  if (h.failures < SENSORS_FAIL_THRESHOLD) return;
+  // Backoff exponencial: 1, 3, 7, 15... ciclos salteados
+  uint8_t shift = h.failures - SENSORS_FAIL_THRESHOLD + 1;
+  if (shift > 7) shift = 7;
+  uint16_t skip = (1U << shift) - 1;
+  h.backoff = skip > SENSORS_BACKOFF_MAX ? SENSORS_BACKOFF_MAX : skip;
+}
+
+uint32_t API_Sensors::alarmedSensors(uint32_t buses, uint32_t mask){
+  Sensor_rom addr;
+  uint32_t moved = 0;
+  // Sin umbrales programados (o tras una falla) no hay alarma confiable
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if (!__alarm_set[i]) moved |= 1UL << i;
+  }
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) {
+    if (!(buses & (1UL << b)) || !(mask & __bus_devices[b])) continue;
+    __bus[b]->reset_alarm_search();
+    while (__bus[b]->alarm_search(addr)) {
+      for (int i = 0; i < DEVICES_CONNECT; i++) {
+        if ((__bus_devices[b] & (1UL << i)) && memcmp(addr, __rom_table[i], sizeof(Sensor_rom)) == 0) {
+          moved |= 1UL << i;
+          break;
+        }
+      }
+    }
+  }
+  return mask & moved;
+}
+
+void API_Sensors::armAlarms(uint32_t mask){
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    if (!(mask & (1UL << i))) continue;
+    // Sólo alrededor de un valor recién leído y con la resolución conocida
+    if (__health[i].failures != 0 || __health[i].backoff != 0 || __resolution[i] == 0) {
+      __alarm_set[i] = false;
+      continue;
+    }
+    // El DS18B20 compara la parte entera: alarma al salir de [f, f+1)
+    int f = __temperature_data[i] >> 4;   // piso de la parte entera
+    int th = f + 1 + SENSORS_MONITOR_MARGIN;
+    int tl = f - 1 - SENSORS_MONITOR_MARGIN;
+    if (th > 125) th = 125;
+    if (tl < -55) tl = -55;
+    __alarm_set[i] = __bus[__rom_bus[i]]->setAlarms(__rom_table[i], (int8_t)th, (int8_t)tl, __resolution[i]);
+  }
+}
+
+void API_Sensors::set_fast_read(bool enable, uint8_t full_every){
+  __fast_read = enable;
+  if (full_every > 0) __full_every = full_every;
+}
+
+void API_Sensors::publish(uint32_t mask){
+  for (int i = 0; i < DEVICES_CONNECT; i++) {
+    __latest.temps_raw[i] = __temperature_data[i];
+    __latest.health[i] = __health[i];
+  }
+  __latest.timestamp_ms = millis();
+  __latest.updated_mask = mask;
+  __latest.bus_time_us = API_Sensors::busTimeUs() - __acq_bus_us;
+  __latest.seq++;
+}
+
+uint32_t API_Sensors::busTimeUs(){
+  uint32_t total = 0;
+  for (int b = 0; b < SENSORS_BUS_COUNT; b++) total += __bus[b]->bus_time_us();
+  return total;
+}
+
 float API_Sensors::getTemperatureId(uint8_t id_sensor) {
-  float write_data[DEVICES_CONNECT];
-  API_Sensors::getTemperatures(write_data);  
-  return write_data[id_sensor];
+  if (id_sensor >= DEVICES_CONNECT) return 0;
+  if (!__rom_valid[id_sensor]) return temp_raw_to_c(__temperature_data[id_sensor]);
+  // Convierte sólo el sensor pedido (bloqueante)
+  API_Sensors::startConversion(1UL << id_sensor);
+  API_Sensors::waitConversion();
+  __acq_state = ACQ_IDLE;
+  API_Sensors::readSensors(1UL << id_sensor, false);
+  API_Sensors::publish(1UL << id_sensor);
+  return temp_raw_to_c(__temperature_data[id_sensor]);
 }
 
 
-void API_Sensors::printAddress(DeviceAddress deviceAddress) {
+void API_Sensors::printAddress(const uint8_t* deviceAddress) {
   for (uint8_t i = 0; i < 8; i++) {
     if (deviceAddress[i] < 16) Serial.print("0");
     Serial.print(deviceAddress[i], HEX);
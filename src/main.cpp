@@ -10,35 +10,46 @@
 #include <DallasTemperature.h>
 
 #include "API_Resistor.h"
+#include "API_Actuator.h"
 #include "API_Sensors.h"
 #include "API_MyTimer.h"
 #include "API_Control_PID.h"
 #include "API_HttpServer.h"
+#include "API_Sampler.h"
+#include "API_ControlLoop.h"
+#include "API_RunConfig.h"
 
 
 API_Resistor      Qin;
 API_Sensors       Temperature;
 API_MyTimer       MyTimer;
 API_Control_PID   PID;
+API_Sampler       Sampler;
+API_ControlLoop   Control;
 
 
 bool exec_option();
 bool exec_run();
 bool exec_stop();
 void send_data();
-void set_cooler_pwm(int percent);
+void set_cooler_pwm(float percent);
 
 // define COOLER cooler
 #define COOLER_PIN          4
 #define COOLER_FREQ         5000
 #define COOLER_CHANNEL      1
-#define COOLER_RESOLUTION   8
+#define COOLER_RESOLUTION   12     // máx. 13 bits a 5 kHz
+#define COOLER_PWM_DITHER   false  // sigma-delta, paso en cada loop()
+#define COOLER_RAMP_UP      0      // %/s (0 = sin límite), aplicada en loop()
+#define COOLER_RAMP_DOWN    0
 #define T_SAMPLE            1000
 #define RANDOM_MINUTES_MIN  1
 #define RANDOM_MINUTES_MAX  10
 
+API_Actuator      Cooler(COOLER_PIN, COOLER_CHANNEL, COOLER_FREQ, COOLER_RESOLUTION, COOLER_PWM_DITHER);
+
 // Se definen el orden de los sensores
-// Mapeo claro: 0 = ambiente, 1..4 = barra
+// Mapeo claro: 0 = ambiente, 1..DEVICES_CONNECT-1 = barra
 enum sensor_order{Troom = 0, Tnode1 = 1, Tnode2 = 2, Tnode3 = 3, Tnode4 = 4};
 
 
@@ -49,7 +60,15 @@ enum sensor_order{Troom = 0, Tnode1 = 1, Tnode2 = 2, Tnode3 = 3, Tnode4 = 4};
 #define PID_U_MAX     2.32
 #define PID_REF       30
 
-PID_config PID_data = {0,0,PID_REF,PID_KP,PID_KI,PID_TS,1,0,PID_U_MAX,0};
+// Ganancias del lazo como Config de compilación (API_Pid.h)
+struct Bar_pid {
+  static constexpr float kp()    { return PID_KP; }
+  static constexpr float ki()    { return PID_KI; }
+  static constexpr float ts()    { return PID_TS; }
+  static constexpr float kb()    { return 1; }
+  static constexpr float u_max() { return PID_U_MAX; }
+  static constexpr float u_min() { return 0; }
+};
 
 
 File dataFile; // Objeto para el archivo de datos
@@ -66,25 +85,37 @@ enum Estado {
   };
 
 Estado estadoActual = coolerLevel; // Estado inicial
-int nodoSeleccionado = 1; // 1..4
+int nodoSeleccionado = 1; // 1..DEVICES_CONNECT-1
 int porcentajeResistencia = 0; // % PWM resistencia (modo fijo)
 int porcentajeCooler = 100; // % cooler
 
-// Estado controlado vía API (ver API_HttpServer.cpp)
+// Estado controlado vía API (ver API_HttpServer.cpp): RUN/STOP y la
+// configuración versionada (modo, nodo, setpoint, porcentajes)
 volatile bool  g_running = false;
-volatile int   g_mode = 0;            // 0=fijo, 1=pid
-volatile int   g_selectedNode = 1;    // 1..4
-volatile float g_setpoint = PID_REF;  // °C
-volatile int   g_fixedPercent = 0;    // 0..100
-volatile int   g_coolerPercent = 100; // 0..100
+API_RunConfig RunConfig(PID_REF, 0, 100);
+// runPID en curso: el paso de la tarea de control escribe el calefactor
+volatile bool  g_pid_active = false;
+
+// Paso PID (tarea de control, núcleo 1, con prioridad sobre loop()) con
+// el dt real desde el paso anterior
+static void controlStep(float dt_s, void*) {
+  if (!g_pid_active || !g_running) return;
+  // Nodo y setpoint de la misma versión de la configuración. A °C sólo en
+  // la ley de control; la salida va en float al PWM
+  Run_config cfg = RunConfig.get();
+  float y = temp_raw_to_c(Sampler.snapshot().temps_raw[cfg.node]);
+  PID.set_reference(cfg.setpoint);
+  float u = 43.1034f * PID.update(y, dt_s);
+  Qin.set_pwm(u);
+}
   
 void init_cooler(){
-  ledcSetup(COOLER_CHANNEL, COOLER_FREQ, COOLER_RESOLUTION);
-  ledcAttachPin(COOLER_PIN, COOLER_CHANNEL);  
+  Cooler.begin();
+  Cooler.set_ramp(COOLER_RAMP_UP, COOLER_RAMP_DOWN);
   set_cooler_pwm(100);   // init cooler at 100%
 }
-void set_cooler_pwm(int percent){
-  ledcWrite(COOLER_CHANNEL, (percent/100.0)*255);  
+void set_cooler_pwm(float percent){
+  Cooler.set(percent);
 }
 
 bool exec_square_cooler(int cooler_speed) {
@@ -120,10 +151,18 @@ void setup() {
   // Inicializa sensores ahora que Serial está listo
   Temperature.init(true);
   Serial.println("[BOOT] Sensors init done");
+  // Desde aquí el bus 1-Wire es exclusivo de la tarea de muestreo
+  Sampler.begin(&Temperature, &Qin);
   init_cooler(); // start cooler  100 %
-  set_cooler_pwm(g_coolerPercent);
+  set_cooler_pwm(RunConfig.get().cooler_percent);
   Qin.set_pwm(0); // power OFF resistor 0%
-  PID.configure(PID_data);  // configura el control  
+  // Potencia del calefactor promediada en segundo plano (núcleo 0), con la
+  // calibración de dos puntos guardada si la hay (NVS ya iniciado aquí)
+  Qin.load_calibration();
+  Qin.begin_sampling();
+  PID.configure<Bar_pid>();  // configura el control
+  PID.set_reference(RunConfig.get().setpoint);
+  Control.begin(controlStep, nullptr, (uint32_t)(PID_TS * 1000000UL));
   // Inicia API HTTP en modo AP con endpoints
   httpServerSetup();
   Serial.println("[BOOT] HTTP server ready");
@@ -133,14 +172,23 @@ void loop() {
   // Servicio HTTP
   httpServerLoop();
 
-  // Aplicar valores recibidos por API
-  set_cooler_pwm(g_coolerPercent);
-  porcentajeResistencia = g_fixedPercent;
-  nodoSeleccionado = g_selectedNode;
+  // Aplicar la configuración recibida por API, una versión entera por
+  // iteración (el actuador sólo escribe si cambian)
+  Run_config cfg = RunConfig.get();
+  set_cooler_pwm(cfg.cooler_percent);
+  Cooler.update();
+  porcentajeResistencia = cfg.fixed_percent;
+  nodoSeleccionado = cfg.node;
+  // El nodo controlado se muestrea a tasa rápida en la tarea de muestreo
+  Temperature.set_control_node(nodoSeleccionado);
+  // La energía de la corrida se atribuye también al nodo seleccionado
+  Qin.set_energy_node(nodoSeleccionado);
+  // En reposo los sensores se vigilan por alarma TH/TL, casi sin tráfico
+  Temperature.set_monitor_mode(!g_running);
 
   // Si RUN está activo, forzamos el estado de ejecución según modo
   if (g_running) {
-    estadoActual = (g_mode == 1) ? runPID : runFijo;
+    estadoActual = (cfg.mode == RUN_MODE_PID) ? runPID : runFijo;
   }
   switch (estadoActual) {
     
@@ -202,8 +250,8 @@ void loop() {
        if (false && Serial.available()) {
         String userInput = Serial.readStringUntil('\n');
         selectedNode = userInput.toInt();
-        // Solo permitir nodos de la barra (1..4). 0 es el sensor ambiente.
-        if (selectedNode >= 1 && selectedNode <= 4) {
+        // Solo permitir nodos de la barra. 0 es el sensor ambiente.
+        if (selectedNode >= 1 && selectedNode < DEVICES_CONNECT) {
           // Configurar el nodo seleccionado
           nodoSeleccionado = selectedNode;
           Serial.println("Nodo seleccionado: " + String(nodoSeleccionado));
@@ -234,36 +282,29 @@ void loop() {
 
     case runPID: { // control PID no-bloqueante
       // Si no está en RUN, salir a idle
-      if (!g_running) { Qin.set_pwm(0); estadoActual = coolerLevel; break; }
-
-      // Ejecutar tareas periódicas sin bloquear
       static bool started = false;
-      static unsigned long last_step_ms = 0;
-      if (!started) { MyTimer.restart(); started = true; }
+      if (!g_running) { g_pid_active = false; Qin.set_pwm(0); if (started) { started = false; Qin.end_run(); } estadoActual = coolerLevel; break; }
+
+      // El paso de control corre en la tarea de control (Control, PID_TS);
+      // aquí sólo arranque, telemetría y parada
+      if (!started) { MyTimer.restart(); started = true; Qin.begin_run(1); }
+      g_pid_active = true;
 
       // Telemetría y lecturas periódicas
       send_data();
 
-      // Paso de control a 1 Hz (T_SAMPLE)
-      unsigned long now = millis();
-      if (now - last_step_ms >= T_SAMPLE) {
-        last_step_ms = now;
-        float y = Temperature.getTemperatureId(nodoSeleccionado);
-        float u = 43.1034f * PID.update(y);
-        Qin.set_pwm(u);
-      }
-
       // Si se recibe STOP por API, salir limpiamente
-      if (!g_running) { Qin.set_pwm(0); started = false; estadoActual = coolerLevel; }
+      if (!g_running) { g_pid_active = false; Qin.set_pwm(0); started = false; Qin.end_run(); estadoActual = coolerLevel; }
       break;
     }
     
     case runFijo: { // control fijo no-bloqueante
-      if (!g_running) { Qin.set_pwm(0); estadoActual = coolerLevel; break; }
-
+      g_pid_active = false;   // el calefactor lo escribe este estado
       static bool started = false;
+      if (!g_running) { Qin.set_pwm(0); if (started) { started = false; Qin.end_run(); } estadoActual = coolerLevel; break; }
+
       static unsigned long last_step_ms = 0;
-      if (!started) { MyTimer.restart(); started = true; }
+      if (!started) { MyTimer.restart(); started = true; Qin.begin_run(0); }
 
       // Telemetría y lecturas periódicas
       send_data();
@@ -275,7 +316,7 @@ void loop() {
         Qin.set_pwm(porcentajeResistencia);
       }
 
-      if (!g_running) { Qin.set_pwm(0); started = false; estadoActual = coolerLevel; }
+      if (!g_running) { Qin.set_pwm(0); started = false; Qin.end_run(); estadoActual = coolerLevel; }
       break;
     }
   }
@@ -352,21 +393,21 @@ void exec_square_random(){
 
 void send_data(){
   static long t1=millis();
-  static float temp_nodos[DEVICES_CONNECT];
   
   if( (millis()-t1)>=T_SAMPLE ) {
     t1 = millis();
     
-    // Test Sensors
-    Temperature.getTemperatures(temp_nodos);
-    Serial.print(temp_nodos[Tnode1]); Serial.print(" ");
-    Serial.print(temp_nodos[Tnode2]); Serial.print(" ");
-    Serial.print(temp_nodos[Tnode3]); Serial.print(" ");
-    Serial.print(temp_nodos[Tnode4]); Serial.print(" ");
+    // Test Sensors: último snapshot publicado por la tarea de muestreo
+    Sample_snapshot snap = Sampler.snapshot();
+    const Temp_raw* temp_nodos = snap.temps_raw;
+    char buf[TEMP_RAW_TEXT_MAX];
+    for (int i = Tnode1; i < DEVICES_CONNECT; i++) {
+      temp_raw_format(buf, temp_nodos[i]); Serial.print(buf); Serial.print(" ");
+    }
     
     // Test Resistor: measurement heat
-    Serial.print(Qin.get_heat());     Serial.print(" ");
-    Serial.println(temp_nodos[Troom]);
+    Serial.print(snap.heater_w);      Serial.print(" ");
+    temp_raw_format(buf, temp_nodos[Troom]); Serial.println(buf);
   }          
 
 }
@@ -51,62 +51,102 @@ export default function TemperatureControlDashboard() {
   const [autoRefresh, setAutoRefresh] = useState(true)
   const [refreshInterval, setRefreshInterval] = useState(1000)
 
-  // Poll real API state
+  // Real API state: /api/stream (SSE, one frame per sample), falling back
+  // to polling /api/state if the stream never delivers a frame
   useEffect(() => {
     if (!autoRefresh) return
     let cancelled = false
+    let id: ReturnType<typeof setInterval> | null = null
+    let es: EventSource | null = null
     const coolerLevelFromPct = (pct: number) => (pct >= 80 ? 3 : pct >= 60 ? 2 : pct >= 30 ? 1 : 0)
+    const apply = (s: any) => {
+      const now = new Date()
+      const ts = now.toLocaleTimeString()
+      const nodes: number[] = s?.temperatures?.nodes || []
+      const room: number = s?.temperatures?.room ?? NaN
+      const setpoint: number = s?.setpoint ?? NaN
+      const newData: TemperatureData = {
+        timestamp: ts,
+        sensor1: nodes[0] ?? NaN,
+        sensor2: nodes[1] ?? NaN,
+        sensor3: nodes[2] ?? NaN,
+        sensor4: nodes[3] ?? NaN,
+        ambient: room,
+        setpoint,
+      }
+      setTemperatureData((prev) => [...prev.slice(-49), newData])
+      setSystemStatus((prev) => ({
+        ...prev,
+        isConnected: true,
+        mode: (s?.mode || 'pid'),
+        heaterPower: typeof s?.control_pct === 'number' ? s.control_pct : prev.heaterPower,
+        coolerSpeed: coolerLevelFromPct(s?.cooler_percent ?? 0),
+        activeNode: Math.max(0, (s?.node ?? 1) - 1),
+      }))
+    }
     const tick = async () => {
       try {
         const res = await fetch(`${API_BASE}/api/state`)
         const s = await res.json()
         if (cancelled) return
-        const now = new Date()
-        const ts = now.toLocaleTimeString()
-        const nodes: number[] = s?.temperatures?.nodes || []
-        const room: number = s?.temperatures?.room ?? NaN
-        const setpoint: number = s?.setpoint ?? NaN
-        const newData: TemperatureData = {
-          timestamp: ts,
-          sensor1: nodes[0] ?? NaN,
-          sensor2: nodes[1] ?? NaN,
-          sensor3: nodes[2] ?? NaN,
-          sensor4: nodes[3] ?? NaN,
-          ambient: room,
-          setpoint,
-        }
-        setTemperatureData((prev) => [...prev.slice(-49), newData])
-        setSystemStatus((prev) => ({
-          ...prev,
-          isConnected: true,
-          mode: (s?.mode || 'pid'),
-          heaterPower: typeof s?.control_pct === 'number' ? s.control_pct : prev.heaterPower,
-          coolerSpeed: coolerLevelFromPct(s?.cooler_percent ?? 0),
-          activeNode: Math.max(0, (s?.node ?? 1) - 1),
-        }))
+        apply(s)
       } catch (e) {
         setSystemStatus((prev) => ({ ...prev, isConnected: false }))
       }
     }
-    const id = setInterval(tick, Math.max(200, refreshInterval))
-    tick()
-    return () => { cancelled = true; clearInterval(id) }
+    const startPolling = () => {
+      id = setInterval(tick, Math.max(200, refreshInterval))
+      tick()
+    }
+    if (typeof EventSource === 'undefined') {
+      startPolling()
+    } else {
+      let gotFrame = false
+      const source = new EventSource(`${API_BASE}/api/stream`)
+      source.onmessage = (ev) => {
+        if (cancelled) return
+        gotFrame = true
+        try { apply(JSON.parse(ev.data)) } catch (e) { /* malformed frame */ }
+      }
+      source.onerror = () => {
+        if (cancelled) return
+        // With earlier frames EventSource reconnects by itself
+        if (gotFrame) { setSystemStatus((prev) => ({ ...prev, isConnected: false })); return }
+        source.close()
+        es = null
+        startPolling()
+      }
+      es = source
+    }
+    return () => {
+      cancelled = true
+      if (id) clearInterval(id)
+      if (es) es.close()
+    }
   }, [autoRefresh, refreshInterval])
 
   const currentTemps = temperatureData.length > 0 ? temperatureData[temperatureData.length - 1] : null
 
   const handleApplySettings = async () => {
     const coolerPct = [0,33,66,100][Math.max(0, Math.min(3, systemStatus.coolerSpeed))]
+    // One atomic POST: the backend validates everything and applies a single config version
+    const pid = systemStatus.mode === 'pid' || systemStatus.mode === 'onoff'
+    const config = pid
+      ? {
+          mode: 'pid',
+          cooler_percent: coolerPct,
+          node: (systemStatus.activeNode ?? 0) + 1,
+          setpoint: Number(pidSettings.setpoint.toFixed(1)),
+        }
+      : { mode: 'fixed', cooler_percent: coolerPct, fixed_percent: Math.round(systemStatus.heaterPower) }
     try {
-      await fetch(`${API_BASE}/api/cooler?percent=${coolerPct}`, { method: 'POST' })
-      if (systemStatus.mode === 'pid' || systemStatus.mode === 'onoff') {
-        await fetch(`${API_BASE}/api/mode?type=pid`, { method: 'POST' })
-        await fetch(`${API_BASE}/api/node?index=${(systemStatus.activeNode ?? 0) + 1}`, { method: 'POST' })
-        await fetch(`${API_BASE}/api/setpoint?temp=${pidSettings.setpoint.toFixed(1)}`, { method: 'POST' })
-      } else {
-        await fetch(`${API_BASE}/api/mode?type=fixed`, { method: 'POST' })
-        await fetch(`${API_BASE}/api/fixed?percent=${Math.round(systemStatus.heaterPower)}`, { method: 'POST' })
-      }
+      const res = await fetch(`${API_BASE}/api/config`, {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json' },
+        body: JSON.stringify(config),
+      })
+      const body = await res.json()
+      if (!res.ok) console.error('Config rejected', body)
     } catch (e) {
       console.error('Error applying settings', e)
     }
@@ -0,0 +1,113 @@
+// Benchmark en host del armado de /api/state: API_JsonWriter sobre un
+// búfer estático frente a concatenación de strings (como el camino con
+// String de Arduino: += por campo y un temporal por cada float).
+// make bench  (o make bench > ../bench_output.txt)
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "API_JsonWriter.h"
+
+// Cuenta las reservas de heap de cada variante
+static unsigned long g_allocs = 0;
+void* operator new(std::size_t n) {
+  g_allocs++;
+  void* p = std::malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static const int ITER = 100000;
+static const int SENSORS = 5;
+
+// Equivalente a String(float, n)
+static std::string fstr(float v, int dec) {
+  char tmp[24];
+  std::snprintf(tmp, sizeof(tmp), "%.*f", dec, v);
+  return std::string(tmp);
+}
+
+static size_t build_string(int k) {
+  std::string json = "{";
+  json += "\"seq\":"; json += std::to_string(k); json += ",";
+  json += "\"running\":"; json += "true"; json += ",";
+  json += "\"mode\":\""; json += "pid"; json += "\",";
+  json += "\"setpoint\":"; json += fstr(30.0f, 1); json += ",";
+  json += "\"temperatures\":{\"room\":"; json += fstr(22.5f, 2); json += ",\"nodes\":[";
+  for (int i = 1; i < SENSORS; i++) { if (i > 1) json += ","; json += fstr(25.0f + i + k * 1e-4f, 2); }
+  json += "]},\"sensor_health\":[";
+  for (int i = 0; i < SENSORS; i++) {
+    if (i > 0) json += ",";
+    json += "{\"crc_errors\":"; json += std::to_string(i);
+    json += ",\"disconnects\":"; json += std::to_string(0);
+    json += ",\"stuck\":"; json += std::to_string(0);
+    json += ",\"last_good_age_ms\":"; json += std::to_string(120 + i);
+    json += "}";
+  }
+  json += "],\"heater_w\":"; json += fstr(1.234f, 3);
+  json += ",\"energy\":{\"total_j\":"; json += fstr(1234.5f + k, 2);
+  json += ",\"run_j\":"; json += fstr(321.0f, 2);
+  json += ",\"node_j\":[";
+  for (int i = 0; i < SENSORS; i++) { if (i > 0) json += ","; json += fstr(10.0f * i, 2); }
+  json += "]}}";
+  return json.size();
+}
+
+static char g_buf[4096];
+static size_t build_writer(int k) {
+  API_JsonWriter w(g_buf, sizeof(g_buf));
+  w.begin_object();
+  w.field("seq", k);
+  w.field("running", true);
+  w.field("mode", "pid");
+  w.field("setpoint", 30.0f, 1);
+  w.key("temperatures"); w.begin_object();
+  w.field("room", 22.5f, 2);
+  w.key("nodes"); w.begin_array();
+  for (int i = 1; i < SENSORS; i++) w.value(25.0f + i + k * 1e-4f, 2);
+  w.end_array();
+  w.end_object();
+  w.key("sensor_health"); w.begin_array();
+  for (int i = 0; i < SENSORS; i++) {
+    w.begin_object();
+    w.field("crc_errors", i);
+    w.field("disconnects", 0);
+    w.field("stuck", 0);
+    w.field("last_good_age_ms", 120 + i);
+    w.end_object();
+  }
+  w.end_array();
+  w.field("heater_w", 1.234f, 3);
+  w.key("energy"); w.begin_object();
+  w.field("total_j", 1234.5f + k, 2);
+  w.field("run_j", 321.0f, 2);
+  w.key("node_j"); w.begin_array();
+  for (int i = 0; i < SENSORS; i++) w.value(10.0f * i, 2);
+  w.end_array();
+  w.end_object();
+  w.end_object();
+  return w.length();
+}
+
+template <typename F>
+static void run(const char* name, F build) {
+  size_t bytes = 0;
+  unsigned long a0 = g_allocs;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < ITER; k++) bytes += build(k);
+  auto t1 = std::chrono::steady_clock::now();
+  double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / ITER;
+  std::printf("%-8s %7.3f us/doc  %6.1f allocs/doc  %zu bytes/doc\n",
+              name, us, (double)(g_allocs - a0) / ITER, bytes / ITER);
+}
+
+int main() {
+  std::printf("JSON de estado: %d documentos\n", ITER);
+  run("string", build_string);
+  run("writer", build_writer);
+  return 0;
+}
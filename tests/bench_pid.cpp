@@ -0,0 +1,94 @@
+// Benchmark en host de Pid<T, Config>: N controladores sobre plantas de
+// primer orden, ns por update() en cada representación, y el mismo lazo
+// en float con Pid_bank<N> (estructura de arreglos, una pasada).
+// make bench  (o make bench > ../bench_output.txt)
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "API_Pid.h"
+#include "API_PidBank.h"
+
+struct Bench_pid {
+  static constexpr float kp()      { return 0.354456662137341f; }
+  static constexpr float ki()      { return 0.000259315631755468f; }
+  static constexpr float ts()      { return 1.0f; }
+  static constexpr float kb()      { return 1.0f; }
+  static constexpr float u_max()   { return 2.32f; }
+  static constexpr float u_min()   { return 0.0f; }
+  static constexpr float y_units() { return 16.0f; }    // Temp_raw
+  static constexpr float u_units() { return 1000.0f; }
+};
+
+static const int CHANNELS = 64;
+static const int STEPS = 20000;
+
+// Planta entera para no medir conversiones: y en las unidades de la variante
+template <typename T> struct Plant;
+template <> struct Plant<float> {
+  static float init() { return 20.0f; }
+  static float ref() { return 30.0f; }
+  static float step(float y, float u) { return y + 0.01f * (20.0f + 8.0f * u - y); }
+  static float out(float y) { return y; }
+};
+template <> struct Plant<Q16_16> {
+  static Q16_16 init() { return Q16_16::from_float(20.0f); }
+  static Q16_16 ref() { return Q16_16::from_float(30.0f); }
+  static Q16_16 step(Q16_16 y, Q16_16 u) {
+    // y += (20 + 8u - y) / 100
+    int32_t d = (20 << 16) + 8 * u.raw - y.raw;
+    return Q16_16{ y.raw + d / 100 };
+  }
+  static float out(Q16_16 y) { return y.to_float(); }
+};
+template <> struct Plant<int32_t> {
+  static int32_t init() { return 20 * 16; }
+  static int32_t ref() { return 30 * 16; }
+  static int32_t step(int32_t y, int32_t u) {
+    // u en milésimas: 8u/1000 °C = u*16*8/1000 cuentas
+    int32_t d = 20 * 16 + u * 128 / 1000 - y;
+    return y + d / 100;
+  }
+  static float out(int32_t y) { return y / 16.0f; }
+};
+
+template <typename T>
+static void run(const char* name) {
+  std::vector<Pid<T, Bench_pid> > pid(CHANNELS);
+  std::vector<T> y(CHANNELS, Plant<T>::init());
+  for (int c = 0; c < CHANNELS; c++) pid[c].set_reference(Plant<T>::ref());
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < STEPS; k++) {
+    for (int c = 0; c < CHANNELS; c++) y[c] = Plant<T>::step(y[c], pid[c].update(y[c]));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)CHANNELS * STEPS);
+  std::printf("%-8s %6.2f ns/update  y_final=%.3f\n", name, ns, Plant<T>::out(y[0]));
+}
+
+static void run_bank() {
+  static Pid_bank<CHANNELS> bank;
+  static float y[CHANNELS], u[CHANNELS];
+  for (int c = 0; c < CHANNELS; c++) {
+    bank.configure<Bench_pid>(c);
+    bank.set_reference(c, 30.0f);
+    y[c] = 20.0f;
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < STEPS; k++) {
+    bank.update(y, u);
+    for (int c = 0; c < CHANNELS; c++) y[c] = Plant<float>::step(y[c], u[c]);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)CHANNELS * STEPS);
+  std::printf("%-8s %6.2f ns/update  y_final=%.3f\n", "bank", ns, y[0]);
+}
+
+int main() {
+  std::printf("Pid<T, Config>: %d canales x %d pasos (incluye la planta)\n", CHANNELS, STEPS);
+  run<float>("float");
+  run<Q16_16>("q16.16");
+  run<int32_t>("int32");
+  run_bank();
+  return 0;
+}
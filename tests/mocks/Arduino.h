@@ -10,6 +10,7 @@
 #include <thread>
 #include <iostream>
 #include <sstream>
+#include <string>
 
 using std::uint8_t;
 
@@ -41,17 +42,36 @@ inline unsigned long millis() {
   return __mock_millis_now;
 }
 
-inline void __mock_set_millis(unsigned long v) { __mock_millis_now = v; }
+// Fracción de milisegundo acumulada por delayMicroseconds()
+inline unsigned long __mock_micros_frac = 0;
+
+inline void __mock_set_millis(unsigned long v) { __mock_millis_now = v; __mock_micros_frac = 0; }
+
+inline unsigned long micros() { return __mock_millis_now * 1000UL + __mock_micros_frac; }
 
 inline void delay(unsigned long ms) {
   __mock_millis_now += ms;
 }
 
+inline void delayMicroseconds(unsigned int us) {
+  unsigned long total = __mock_micros_frac + us;
+  __mock_millis_now += total / 1000;
+  __mock_micros_frac = total % 1000;
+}
+
 // GPIO / PWM stubs
 inline void pinMode(int, int) {}
-inline void ledcSetup(int, int, int) {}
-inline void ledcAttachPin(int, int) {}
-inline void ledcWrite(int, int) {}
+// LEDC: 16 canales; ledcSetup() falla (0) si freq * 2^bits supera 80 MHz
+inline uint32_t __mock_ledc_duty[16] = {0};
+inline uint8_t __mock_ledc_bits[16] = {0};
+inline unsigned long __mock_ledc_writes = 0;
+inline uint32_t ledcSetup(uint8_t chan, uint32_t freq, uint8_t bits) {
+  if (bits > 20 || ((unsigned long long)freq << bits) > 80000000ULL) return 0;
+  __mock_ledc_bits[chan & 15] = bits;
+  return freq;
+}
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline void ledcWrite(uint8_t chan, uint32_t duty) { __mock_ledc_duty[chan & 15] = duty; __mock_ledc_writes++; }
 
 // analogRead mockable callback
 using AnalogReadCallback = int(*)(int);
@@ -64,6 +84,50 @@ inline int analogRead(int pin) {
   return 0;
 }
 
+inline long random(long lo, long hi) { return hi > lo ? lo + std::rand() % (hi - lo) : lo; }
+inline uint32_t esp_random() { return (uint32_t)std::rand(); }
+
+// String mínimo sobre std::string: lo justo para main.cpp y API_HttpServer.cpp
+class String {
+public:
+  String() {}
+  String(const char* s) : __s(s ? s : "") {}
+  String(const std::string& s) : __s(s) {}
+  String(int v) : __s(std::to_string(v)) {}
+  String(long v) : __s(std::to_string(v)) {}
+  String(unsigned long v) : __s(std::to_string(v)) {}
+  String(float v, int decimals = 2) {
+    char b[32]; std::snprintf(b, sizeof(b), "%.*f", decimals, v); __s = b;
+  }
+  String(double v, int decimals = 2) : String((float)v, decimals) {}
+  String& operator+=(const String& o) { __s += o.__s; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.__s + b.__s); }
+  bool operator==(const String& o) const { return __s == o.__s; }
+  bool equals(const String& o) const { return __s == o.__s; }
+  long toInt() const { return std::atol(__s.c_str()); }
+  float toFloat() const { return (float)std::atof(__s.c_str()); }
+  unsigned int length() const { return (unsigned int)__s.size(); }
+  char operator[](unsigned int i) const { return i < __s.size() ? __s[i] : 0; }
+  int indexOf(char c, unsigned int from = 0) const { return find(std::string(1, c), from); }
+  int indexOf(const String& s, unsigned int from = 0) const { return find(s.__s, from); }
+  String substring(unsigned int from, unsigned int to) const {
+    return from < to && from < __s.size() ? String(__s.substr(from, to - from)) : String();
+  }
+  void trim() {
+    size_t a = __s.find_first_not_of(" \t\r\n"), b = __s.find_last_not_of(" \t\r\n");
+    __s = a == std::string::npos ? std::string() : __s.substr(a, b - a + 1);
+  }
+  const char* c_str() const { return __s.c_str(); }
+  friend std::ostream& operator<<(std::ostream& os, const String& s) { return os << s.__s; }
+
+private:
+  int find(const std::string& s, unsigned int from) const {
+    size_t pos = __s.find(s, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+  }
+  std::string __s;
+};
+
 // Mock Serial
 class MockSerial {
 public:
@@ -73,9 +137,11 @@ public:
   template<typename T>
   void println(const T& v) { std::cout << v << std::endl; }
   void println() { std::cout << std::endl; }
+  template<typename... Args>
+  void printf(const char* fmt, Args... args) { std::printf(fmt, args...); }
   int available() { return 0; }
   // Simple stub; not used in our tests
-  const char* readStringUntil(char) { return ""; }
+  String readStringUntil(char) { return String(); }
 
   // Overloads with base (DEC/HEX)
   void print(long v, int base) { print_number(v, base); }
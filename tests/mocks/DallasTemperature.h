@@ -2,40 +2,109 @@
 #pragma once
 
 #include <cstdint>
+#include "Arduino.h"
 #include "OneWire.h"
+#include "Preferences.h"
 
 using std::uint8_t;
 
 typedef uint8_t DeviceAddress[8];
 
+#define DEVICE_DISCONNECTED_C -127
+
 class DallasTemperature {
 public:
-  explicit DallasTemperature(OneWire*) {}
+  explicit DallasTemperature(OneWire* wire) : wire_(wire) {}
 
   void begin() {}
 
-  int getDeviceCount() const { return devices_; }
+  int getDeviceCount() { return wire_->bus().count; }
+
+  bool validAddress(const uint8_t* addr) { return OneWire::crc8(addr, 7) == addr[7]; }
 
-  bool getAddress(DeviceAddress& addr, int i) {
-    (void)addr; (void)i; return true;
+  bool validFamily(const uint8_t* addr) {
+    return addr[0] == 0x28 || addr[0] == 0x10 || addr[0] == 0x22 || addr[0] == 0x42;
   }
 
-  void requestTemperatures() {}
+  // Igual que la librería real: cada llamada repite la búsqueda desde cero
+  bool getAddress(uint8_t* addr, uint8_t index) {
+    uint8_t depth = 0;
+    wire_->reset_search();
+    while (depth <= index && wire_->search(addr)) {
+      if (depth == index && validAddress(addr)) return true;
+      depth++;
+    }
+    return false;
+  }
+
+  void requestTemperatures() {
+    __mock_ds18b20_convert(wire_->bus(), -1);
+    if (wait_) delay(wire_->bus().conv_ms);
+  }
 
-  float getTempC(DeviceAddress) {
-    // Return a deterministic temperature in tests
-    float t = base_temp_ + static_cast<float>(counter_ % 5);
-    counter_++;
-    return t;
+  bool requestTemperaturesByAddress(const uint8_t* addr) {
+    int i = wire_->bus().find(addr);
+    if (i < 0) return false;
+    __mock_ds18b20_convert(wire_->bus(), i);
+    if (wait_) delay(wire_->bus().conv_ms);
+    return true;
   }
 
-  // Test controls
-  static void __mock_set_devices(int n) { devices_ = n; }
-  static void __mock_set_base_temp(float t) { base_temp_ = t; }
+  void setWaitForConversion(bool flag) { wait_ = flag; }
+  bool getWaitForConversion() { return wait_; }
+
+  bool isConversionComplete() { return __mock_ds18b20_done(wire_->bus()); }
+
+  void setAutoSaveScratchPad(bool flag) { auto_save_ = flag; }
+
+  // Resolución global = la mayor de los sensores presentes (como la librería)
+  uint8_t getResolution() {
+    MockOneWireBus& b = wire_->bus();
+    uint8_t bits = 9;
+    for (int i = 0; i < b.count; i++) {
+      if (b.present[i] && b.resolution[i] > bits) bits = b.resolution[i];
+    }
+    return bits;
+  }
+
+  uint8_t getResolution(const uint8_t* addr) {
+    int i = wire_->bus().find(addr);
+    return i < 0 ? 0 : wire_->bus().resolution[i];
+  }
+
+  bool setResolution(const uint8_t* addr, uint8_t bits, bool = false) {
+    int i = wire_->bus().find(addr);
+    if (i < 0) return false;
+    wire_->bus().resolution[i] = bits;
+    __mock_ds18b20.resolution_writes++;
+    return true;
+  }
+
+  uint16_t millisToWaitForConversion(uint8_t bits) { return __mock_ds18b20_conv_ms(bits); }
+
+  float getTempC(const uint8_t* addr) {
+    if (wire_->bus().find(addr) < 0) return DEVICE_DISCONNECTED_C;
+    __mock_ds18b20.scratchpad_bytes += 9;
+    return __mock_ds18b20_temp();
+  }
+
+  // Test controls (comunes a todos los backends)
+  // Reinicia el hardware simulado: buses y NVS (mapa de roles guardado)
+  static void __mock_set_devices(int n) {
+    __mock_onewire_buses.clear();
+    __mock_nvs_clear();
+    __mock_onewire_set_devices(n);
+  }
+  static void __mock_set_base_temp(float t) { __mock_ds18b20.base_temp = t; }
+  static void __mock_set_ripple(int n) { __mock_ds18b20.ripple = n; }
+  static int __mock_requests() { return __mock_ds18b20.requests; }
+  static int __mock_by_address_requests() { return __mock_ds18b20.by_address_requests; }
+  static int __mock_resolution_writes() { return __mock_ds18b20.resolution_writes; }
+  static int __mock_scratchpad_bytes() { return __mock_ds18b20.scratchpad_bytes; }
+  static int __mock_alarm_writes() { return __mock_ds18b20.alarm_writes; }
 
 private:
-  static inline int devices_ = 5;
-  static inline float base_temp_ = 25.0f;
-  static inline int counter_ = 0;
+  OneWire* wire_;
+  bool wait_ = true;
+  bool auto_save_ = true;
 };
-
@@ -1,8 +1,223 @@
-// Minimal OneWire mock
+// Minimal OneWire mock with a simulated device list
 #pragma once
 
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include "Arduino.h"
+
+using std::uint8_t;
+
+// Bus simulado (uno por pin) compartido por los mocks de OneWire,
+// DallasTemperature y OneWireNg/DSTherm
+struct MockOneWireBus {
+  static constexpr int kMaxDevices = 32;
+  uint8_t roms[kMaxDevices][8] = {};
+  bool present[kMaxDevices] = {};
+  uint8_t resolution[kMaxDevices] = {};
+  uint8_t fault[kMaxDevices] = {};   // MOCK_FAULT_* de cada sensor
+  float offset[kMaxDevices] = {};    // temperatura propia respecto de base_temp
+  int8_t th[kMaxDevices] = {};
+  int8_t tl[kMaxDevices] = {};
+  bool alarm[kMaxDevices] = {};      // fuera de TH/TL en la última conversión
+  int count = 0;
+  int searches = 0;    // pasos de search() (uno por ROM encontrada o fin)
+  unsigned long request_ms = 0;
+  uint16_t conv_ms = 750;
+
+  int find(const uint8_t* addr) const {
+    for (int i = 0; i < count; i++) {
+      if (present[i] && std::memcmp(addr, roms[i], 8) == 0) return i;
+    }
+    return -1;
+  }
+};
+
+inline std::map<int, MockOneWireBus> __mock_onewire_buses;
+
+inline MockOneWireBus& __mock_onewire_bus_at(int pin) { return __mock_onewire_buses[pin]; }
+
+// Fallas inyectables por sensor (la ausencia se simula con present = false)
+enum {
+  MOCK_FAULT_NONE = 0,
+  MOCK_FAULT_CRC,       // scratchpad con CRC corrupto
+  MOCK_FAULT_POWER_ON,  // reinicio por alimentación: 85 °C con CRC válido
+  MOCK_FAULT_SHORTED    // bus en corto a masa: todo ceros
+};
+
+// Simulación DS18B20 común a todos los buses
+struct MockDs18b20Sim {
+  float base_temp = 25.0f;
+  int ripple = 5;              // temperatura = base + (contador % ripple)
+  int counter = 0;
+  int requests = 0;            // conversiones de todo el bus
+  int by_address_requests = 0; // conversiones de un solo sensor
+  int resolution_writes = 0;
+  int scratchpad_bytes = 0;    // bytes de scratchpad leídos (9 por lectura completa)
+  int alarm_writes = 0;        // escrituras crudas de TH/TL/configuración
+};
+
+inline MockDs18b20Sim __mock_ds18b20;
+
+inline uint16_t __mock_ds18b20_conv_ms(uint8_t bits) {
+  switch (bits) {
+    case 9:  return 94;
+    case 10: return 188;
+    case 11: return 375;
+    default: return 750;
+  }
+}
+
+// Alarma del DS18B20: compara la parte entera con TH/TL al convertir
+inline void __mock_ds18b20_eval_alarm(MockOneWireBus& b, int i) {
+  int t = static_cast<int>(std::floor(__mock_ds18b20.base_temp + b.offset[i]));
+  b.alarm[i] = t >= b.th[i] || t <= b.tl[i];
+}
+
+// Arranca una conversión: idx < 0 = todo el bus
+inline void __mock_ds18b20_convert(MockOneWireBus& b, int idx) {
+  uint8_t bits = 9;
+  if (idx < 0) {
+    __mock_ds18b20.requests++;
+    for (int i = 0; i < b.count; i++) {
+      if (b.present[i] && b.resolution[i] > bits) bits = b.resolution[i];
+      __mock_ds18b20_eval_alarm(b, i);
+    }
+  } else {
+    __mock_ds18b20.by_address_requests++;
+    bits = b.resolution[idx];
+    __mock_ds18b20_eval_alarm(b, idx);
+  }
+  b.request_ms = millis();
+  b.conv_ms = __mock_ds18b20_conv_ms(bits);
+}
+
+inline bool __mock_ds18b20_done(const MockOneWireBus& b) {
+  return millis() - b.request_ms >= b.conv_ms;
+}
+
+// Return a deterministic temperature in tests
+inline float __mock_ds18b20_temp() {
+  float t = __mock_ds18b20.base_temp + static_cast<float>(__mock_ds18b20.counter % __mock_ds18b20.ripple);
+  __mock_ds18b20.counter++;
+  return t;
+}
+
+// Scratchpad del sensor idx (temperatura, configuración y CRC significativos)
+inline void __mock_ds18b20_scratchpad(const MockOneWireBus& b, int idx, uint8_t sp[9],
+                                      uint8_t (*crc)(const uint8_t*, uint8_t)) {
+  std::memset(sp, 0, 9);
+  if (b.fault[idx] == MOCK_FAULT_SHORTED) return;
+  float t = b.fault[idx] == MOCK_FAULT_POWER_ON ? 85.0f : __mock_ds18b20_temp() + b.offset[idx];
+  int16_t raw = static_cast<int16_t>(t * 16.0f);
+  sp[0] = static_cast<uint8_t>(raw & 0xff);
+  sp[1] = static_cast<uint8_t>((raw >> 8) & 0xff);
+  sp[2] = static_cast<uint8_t>(b.th[idx]);
+  sp[3] = static_cast<uint8_t>(b.tl[idx]);
+  sp[4] = static_cast<uint8_t>(0x1f | ((b.resolution[idx] - 9) << 5));
+  sp[8] = crc(sp, 8);
+  if (b.fault[idx] == MOCK_FAULT_CRC) sp[8] ^= 0x5a;
+}
+
 class OneWire {
 public:
-  explicit OneWire(int) {}
+  explicit OneWire(int pin) : pin_(pin) {}
+
+  MockOneWireBus& bus() { return __mock_onewire_bus_at(pin_); }
+
+  void reset_search() { search_pos_ = 0; }
+
+  // Transacciones crudas: reset / select / READ SCRATCHPAD / read
+  uint8_t reset() {
+    selected_ = -1;
+    sp_pos_ = 9;
+    wr_pos_ = -1;
+    MockOneWireBus& b = bus();
+    for (int i = 0; i < b.count; i++) if (b.present[i]) return 1;
+    return 0;
+  }
+
+  void select(const uint8_t rom[8]) { selected_ = bus().find(rom); }
+
+  void write(uint8_t v, uint8_t = 0) {
+    // WRITE SCRATCHPAD (0x4E): TH, TL y configuración
+    if (wr_pos_ >= 0 && wr_pos_ < 3) {
+      MockOneWireBus& b = bus();
+      if (wr_pos_ == 0) b.th[selected_] = static_cast<int8_t>(v);
+      else if (wr_pos_ == 1) b.tl[selected_] = static_cast<int8_t>(v);
+      else b.resolution[selected_] = static_cast<uint8_t>(9 + ((v >> 5) & 0x03));
+      if (++wr_pos_ == 3) __mock_ds18b20.alarm_writes++;
+      return;
+    }
+    if (v == 0x4E && selected_ >= 0) { wr_pos_ = 0; return; }
+    if (v == 0xBE && selected_ >= 0) {
+      __mock_ds18b20_scratchpad(bus(), selected_, sp_, OneWire::crc8);
+      sp_pos_ = 0;
+    }
+  }
+
+  uint8_t read() {
+    if (sp_pos_ >= 9) return 0xff;
+    __mock_ds18b20.scratchpad_bytes++;
+    return sp_[sp_pos_++];
+  }
+
+  // search_mode = false: ALARM SEARCH, sólo sensores en alarma
+  bool search(uint8_t* addr, bool search_mode = true) {
+    MockOneWireBus& b = bus();
+    b.searches++;
+    while (search_pos_ < b.count) {
+      int i = search_pos_++;
+      if (!b.present[i] || (!search_mode && !b.alarm[i])) continue;
+      std::memcpy(addr, b.roms[i], 8);
+      return true;
+    }
+    return false;
+  }
+
+  static uint8_t crc8(const uint8_t* addr, uint8_t len) {
+    uint8_t crc = 0;
+    while (len--) {
+      uint8_t inbyte = *addr++;
+      for (uint8_t i = 8; i; i--) {
+        uint8_t mix = (crc ^ inbyte) & 0x01;
+        crc >>= 1;
+        if (mix) crc ^= 0x8C;
+        inbyte >>= 1;
+      }
+    }
+    return crc;
+  }
+
+private:
+  int pin_;
+  int search_pos_ = 0;
+  int selected_ = -1;
+  uint8_t sp_[9] = {};
+  int sp_pos_ = 9;
+  int wr_pos_ = -1;
 };
 
+// Test controls: n sensores DS18B20 (familia 0x28, 12 bits) con CRC válido
+// en el bus del pin indicado (15 = ONE_WIRE_BUS del proyecto)
+inline void __mock_onewire_set_devices(int n, int pin = 15) {
+  if (n > MockOneWireBus::kMaxDevices) n = MockOneWireBus::kMaxDevices;
+  MockOneWireBus& b = __mock_onewire_bus_at(pin);
+  b.count = n;
+  for (int i = 0; i < n; i++) {
+    uint8_t* rom = b.roms[i];
+    std::memset(rom, 0, 8);
+    rom[0] = 0x28;
+    rom[1] = static_cast<uint8_t>(i + 1);
+    rom[2] = static_cast<uint8_t>(pin);
+    rom[7] = OneWire::crc8(rom, 7);
+    b.present[i] = true;
+    b.resolution[i] = 12;
+    b.fault[i] = MOCK_FAULT_NONE;
+    b.offset[i] = 0;
+    b.th[i] = 75;    // valores de fábrica
+    b.tl[i] = 70;
+    b.alarm[i] = false;
+  }
+}
@@ -1,2 +1,105 @@
-// Placeholder for OneWireNg
+// Minimal OneWireNg mock backed by the simulated bus of OneWire.h
 #pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "OneWire.h"
+
+class OneWireNg {
+public:
+  typedef enum {
+    EC_SUCCESS = 0,
+    EC_MORE = EC_SUCCESS,
+    EC_NO_DEVS,
+    EC_BUS_ERROR,
+    EC_CRC_ERROR,
+    EC_UNSUPPORED,
+    EC_FULL
+  } ErrorCode;
+
+  typedef uint8_t Id[8];
+
+  explicit OneWireNg(int pin) : pin_(pin) {}
+  virtual ~OneWireNg() {}
+
+  MockOneWireBus& bus() { return __mock_onewire_bus_at(pin_); }
+
+  void searchReset() { search_pos_ = 0; }
+
+  ErrorCode reset() {
+    selected_ = -1;
+    sp_pos_ = 9;
+    MockOneWireBus& b = bus();
+    for (int i = 0; i < b.count; i++) if (b.present[i]) return EC_SUCCESS;
+    return EC_NO_DEVS;
+  }
+
+  // Como OneWireNg: reset + MATCH ROM; EC_NO_DEVS sin pulso de presencia
+  ErrorCode addressSingle(const Id& id) {
+    ErrorCode ec = reset();
+    if (ec == EC_SUCCESS) selected_ = bus().find(id);
+    return ec;
+  }
+
+  void writeByte(uint8_t v, bool = false) {
+    if (v == 0xBE && selected_ >= 0) {
+      __mock_ds18b20_scratchpad(bus(), selected_, sp_, OneWire::crc8);
+      sp_pos_ = 0;
+    }
+  }
+
+  uint8_t readByte(bool = false) {
+    if (sp_pos_ >= 9) return 0xff;
+    __mock_ds18b20.scratchpad_bytes++;
+    return sp_[sp_pos_++];
+  }
+
+  ErrorCode searchFilterAdd(uint8_t code) {
+    if (filters_ >= 8) return EC_FULL;
+    filter_[filters_++] = code;
+    return EC_SUCCESS;
+  }
+
+  // Como OneWireNg 0.14: EC_MORE con un id por dispositivo (también el
+  // último), EC_NO_DEVS cuando no queda ninguno
+  // alarm = true: ALARM SEARCH, sólo sensores en alarma
+  ErrorCode search(Id& id, bool alarm = false) {
+    MockOneWireBus& b = bus();
+    b.searches++;
+    int found = -1;
+    while (search_pos_ < b.count) {
+      int i = search_pos_++;
+      if (matches(b, i, alarm)) { found = i; break; }
+    }
+    if (found < 0) return EC_NO_DEVS;
+    std::memcpy(id, b.roms[found], sizeof(Id));
+    return EC_MORE;
+  }
+
+  // Read slot: 0 mientras hay una conversión en curso
+  int touchBit(int, bool = false) { return __mock_ds18b20_done(bus()) ? 1 : 0; }
+
+  static uint8_t crc8(const void* in, size_t len, uint8_t = 0) {
+    return OneWire::crc8(static_cast<const uint8_t*>(in), static_cast<uint8_t>(len));
+  }
+
+private:
+  bool matches(const MockOneWireBus& b, int i, bool alarm) const {
+    return b.present[i] && accepts(b.roms[i][0]) && (!alarm || b.alarm[i]);
+  }
+
+  bool accepts(uint8_t family) const {
+    if (!filters_) return true;
+    for (int i = 0; i < filters_; i++) if (filter_[i] == family) return true;
+    return false;
+  }
+
+  int pin_;
+  int search_pos_ = 0;
+  int selected_ = -1;
+  uint8_t sp_[9] = {};
+  int sp_pos_ = 9;
+  uint8_t filter_[8] = {};
+  int filters_ = 0;
+};
@@ -1,3 +1,10 @@
-// Provide OneWire symbol for API_Sensors via this include
+// Provide OneWire symbol for API_Sensors via this include, plus the
+// OneWireNg platform class used by the DSTherm backend
 #pragma once
 #include "OneWire.h"
+#include "OneWireNg.h"
+
+class OneWireNg_CurrentPlatform : public OneWireNg {
+public:
+  OneWireNg_CurrentPlatform(int pin, bool) : OneWireNg(pin) {}
+};
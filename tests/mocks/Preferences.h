@@ -0,0 +1,53 @@
+// Minimal Preferences (NVS) mock: almacenamiento en memoria por proceso
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+inline std::map<std::string, std::vector<uint8_t>> __mock_nvs;
+inline int __mock_nvs_writes = 0;
+
+inline void __mock_nvs_clear() { __mock_nvs.clear(); }
+
+class Preferences {
+public:
+  bool begin(const char* name, bool read_only = false, const char* = nullptr) {
+    ns_ = name;
+    read_only_ = read_only;
+    return true;
+  }
+  void end() { ns_.clear(); }
+
+  size_t putBytes(const char* key, const void* value, size_t len) {
+    if (read_only_ || ns_.empty()) return 0;
+    const uint8_t* p = static_cast<const uint8_t*>(value);
+    __mock_nvs[ns_ + "/" + key].assign(p, p + len);
+    __mock_nvs_writes++;
+    return len;
+  }
+
+  size_t getBytesLength(const char* key) {
+    auto it = __mock_nvs.find(ns_ + "/" + key);
+    return it == __mock_nvs.end() ? 0 : it->second.size();
+  }
+
+  size_t getBytes(const char* key, void* buf, size_t max_len) {
+    auto it = __mock_nvs.find(ns_ + "/" + key);
+    if (it == __mock_nvs.end() || it->second.size() > max_len) return 0;
+    std::memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+  }
+
+  bool remove(const char* key) {
+    if (read_only_) return false;
+    return __mock_nvs.erase(ns_ + "/" + key) > 0;
+  }
+
+private:
+  std::string ns_;
+  bool read_only_ = false;
+};
@@ -0,0 +1,3 @@
+#pragma once
+// Mock mínimo: main.cpp declara un File pero no escribe la SD
+class File {};
@@ -0,0 +1,2 @@
+#pragma once
+// Mock vacío: main.cpp lo incluye pero no lo usa
@@ -0,0 +1,33 @@
+// Minimal WebServer mock: argumentos y encabezados del pedido cargados por
+// el test, y la última respuesta guardada para revisarla
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include "WiFi.h"
+#include "http_parser.h"
+
+typedef enum http_method HTTPMethod;
+
+class WebServer {
+public:
+  explicit WebServer(int) {}
+  void on(const char*, HTTPMethod, std::function<void(void)>) {}
+  void begin() {}
+  void handleClient() {}
+  void collectHeaders(const char**, size_t) {}
+  bool hasArg(const char* name) { return __mock_args.count(name) != 0; }
+  String arg(const char* name) { return hasArg(name) ? String(__mock_args[name]) : String(); }
+  String header(const char*) { return String(); }
+  void sendHeader(const char*, const char*) {}
+  void send_P(int code, const char*, const char* body, size_t len) {
+    __mock_code = code;
+    __mock_body.assign(body, len);
+  }
+  WiFiClient client() { return WiFiClient(); }
+
+  std::map<std::string, std::string> __mock_args;
+  int __mock_code = 0;
+  std::string __mock_body;
+};
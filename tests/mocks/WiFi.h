@@ -0,0 +1,31 @@
+// Minimal WiFi mock: sin red, sólo lo que usa API_HttpServer.cpp
+#pragma once
+
+#include "Arduino.h"
+
+enum { WIFI_MODE_STA = 1, WIFI_STA = 1, WIFI_AP = 2, WL_CONNECTED = 3 };
+
+struct IPAddress {
+  String toString() const { return String("0.0.0.0"); }
+  friend std::ostream& operator<<(std::ostream& os, const IPAddress&) { return os << "0.0.0.0"; }
+};
+
+class WiFiClass {
+public:
+  int getMode() { return 0; }
+  void mode(int) {}
+  void begin(const char*, const char*) {}
+  void softAP(const char*, const char*) {}
+  int status() { return 0; }
+  IPAddress localIP() { return IPAddress(); }
+  IPAddress softAPIP() { return IPAddress(); }
+};
+
+inline WiFiClass WiFi;
+
+class WiFiClient {
+public:
+  int fd() const { return -1; }
+  size_t print(const char*) { return 0; }
+  void stop() {}
+};
@@ -0,0 +1,17 @@
+// Minimal ESP-IDF ADC1 driver mock (routes to analogRead mock)
+#pragma once
+
+#include "Arduino.h"
+
+typedef enum {
+  ADC1_CHANNEL_0 = 0, ADC1_CHANNEL_1, ADC1_CHANNEL_2, ADC1_CHANNEL_3,
+  ADC1_CHANNEL_4, ADC1_CHANNEL_5, ADC1_CHANNEL_6, ADC1_CHANNEL_7
+} adc1_channel_t;
+
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef enum { ADC_WIDTH_BIT_12 = 3 } adc_bits_width_t;
+typedef enum { ADC_ATTEN_DB_0 = 0, ADC_ATTEN_DB_12 = 3 } adc_atten_t;
+
+inline int adc1_config_width(adc_bits_width_t) { return 0; }
+inline int adc1_config_channel_atten(adc1_channel_t, adc_atten_t) { return 0; }
+inline int adc1_get_raw(adc1_channel_t ch) { return analogRead(static_cast<int>(ch)); }
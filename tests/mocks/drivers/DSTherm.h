@@ -0,0 +1,69 @@
+// Minimal OneWireNg DSTherm driver mock backed by the simulated bus
+#pragma once
+
+#include <new>
+#include "OneWireNg.h"
+#include "utils/Placeholder.h"
+
+class DSTherm {
+public:
+  static const uint8_t DS18B20 = 0x28;
+  static const uint32_t MAX_CONV_TIME = 750;
+
+  typedef enum { RES_9_BIT = 0, RES_10_BIT, RES_11_BIT, RES_12_BIT } Resolution;
+
+  class Scratchpad {
+  public:
+    Scratchpad(long temp_milli, int8_t th, int8_t tl, Resolution res)
+      : temp_(temp_milli), th_(th), tl_(tl), res_(res) {}
+    long getTemp() const { return temp_; }
+    int8_t getTh() const { return th_; }
+    int8_t getTl() const { return tl_; }
+    Resolution getResolution() const { return res_; }
+
+  private:
+    long temp_;
+    int8_t th_, tl_;
+    Resolution res_;
+  };
+
+  explicit DSTherm(OneWireNg& ow) : ow_(ow) {}
+
+  OneWireNg::ErrorCode convertTemp(const OneWireNg::Id& id, uint32_t maxConvTime = MAX_CONV_TIME, bool = false) {
+    int i = ow_.bus().find(id);
+    if (i < 0) return OneWireNg::EC_NO_DEVS;
+    __mock_ds18b20_convert(ow_.bus(), i);
+    if (maxConvTime) delay(maxConvTime);
+    return OneWireNg::EC_SUCCESS;
+  }
+
+  OneWireNg::ErrorCode convertTempAll(uint32_t maxConvTime = MAX_CONV_TIME, bool = false) {
+    __mock_ds18b20_convert(ow_.bus(), -1);
+    if (maxConvTime) delay(maxConvTime);
+    return OneWireNg::EC_SUCCESS;
+  }
+
+  OneWireNg::ErrorCode readScratchpad(const OneWireNg::Id& id, Placeholder<Scratchpad>& scrpd) {
+    int i = ow_.bus().find(id);
+    if (i < 0) return OneWireNg::EC_CRC_ERROR;   // sin respuesta: todo 0xff
+    __mock_ds18b20.scratchpad_bytes += 9;
+    long milli = static_cast<long>(__mock_ds18b20_temp() * 1000.0f);
+    new (&scrpd) Scratchpad(milli, ow_.bus().th[i], ow_.bus().tl[i], static_cast<Resolution>(ow_.bus().resolution[i] - 9));
+    return OneWireNg::EC_SUCCESS;
+  }
+
+  OneWireNg::ErrorCode writeScratchpad(const OneWireNg::Id& id, int8_t th, int8_t tl, uint8_t res) {
+    int i = ow_.bus().find(id);
+    if (i < 0) return OneWireNg::EC_NO_DEVS;
+    ow_.bus().th[i] = th;
+    ow_.bus().tl[i] = tl;
+    ow_.bus().resolution[i] = static_cast<uint8_t>(res + 9);
+    // Escribe TH, TL y configuración juntos: cuenta para ambos contadores
+    __mock_ds18b20.resolution_writes++;
+    __mock_ds18b20.alarm_writes++;
+    return OneWireNg::EC_SUCCESS;
+  }
+
+private:
+  OneWireNg& ow_;
+};
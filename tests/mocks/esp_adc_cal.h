@@ -0,0 +1,37 @@
+// Minimal esp_adc_cal mock: característica lineal ideal (0..4095 -> 0..3300 mV)
+#pragma once
+
+#include <cstdint>
+#include "driver/adc.h"
+
+typedef enum {
+  ESP_ADC_CAL_VAL_EFUSE_VREF = 0,
+  ESP_ADC_CAL_VAL_EFUSE_TP = 1,
+  ESP_ADC_CAL_VAL_DEFAULT_VREF = 2,
+} esp_adc_cal_value_t;
+
+typedef struct {
+  adc_unit_t adc_num;
+  adc_atten_t atten;
+  adc_bits_width_t bit_width;
+  uint32_t coeff_a;
+  uint32_t coeff_b;
+  uint32_t vref;
+} esp_adc_cal_characteristics_t;
+
+inline esp_adc_cal_value_t __mock_adc_cal_source = ESP_ADC_CAL_VAL_EFUSE_TP;
+
+inline esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t unit, adc_atten_t atten, adc_bits_width_t width,
+                                                    uint32_t default_vref, esp_adc_cal_characteristics_t* chars) {
+  chars->adc_num = unit;
+  chars->atten = atten;
+  chars->bit_width = width;
+  chars->coeff_a = 0;
+  chars->coeff_b = 0;
+  chars->vref = default_vref;
+  return __mock_adc_cal_source;
+}
+
+inline uint32_t esp_adc_cal_raw_to_voltage(uint32_t raw, const esp_adc_cal_characteristics_t*) {
+  return (raw * 3300 + 2047) / 4095;
+}
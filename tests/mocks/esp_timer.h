@@ -0,0 +1,30 @@
+// Minimal esp_timer mock: el reloj es el de micros(); los timers no corren
+#pragma once
+
+#include <cstdint>
+#include "Arduino.h"
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+typedef void* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char* name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+inline int64_t esp_timer_get_time() { return (int64_t)micros(); }
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t*, esp_timer_handle_t* out) {
+  if (out) *out = nullptr;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t, uint64_t) { return ESP_OK; }
+inline esp_err_t esp_timer_stop(esp_timer_handle_t) { return ESP_OK; }
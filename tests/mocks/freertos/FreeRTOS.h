@@ -0,0 +1,17 @@
+// Minimal FreeRTOS mock (tasks are never started on the host)
+#pragma once
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xffffffffUL
+#define configMAX_PRIORITIES 25
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
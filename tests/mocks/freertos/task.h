@@ -0,0 +1,17 @@
+// Minimal FreeRTOS task mock
+#pragma once
+
+#include "FreeRTOS.h"
+#include "Arduino.h"
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*,
+                                          unsigned, TaskHandle_t* handle, int) {
+  if (handle) *handle = nullptr;
+  return pdPASS;
+}
+
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+// Notificaciones: sin planificador, la toma nunca bloquea
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 1; }
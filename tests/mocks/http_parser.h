@@ -0,0 +1,3 @@
+#pragma once
+// Mock: sólo los métodos que registra la API
+enum http_method { HTTP_GET, HTTP_POST, HTTP_OPTIONS };
@@ -0,0 +1,4 @@
+#pragma once
+// Mock: los sockets de lwip son los POSIX del host
+#include <sys/socket.h>
+#include <unistd.h>
@@ -0,0 +1,15 @@
+// Minimal OneWireNg Placeholder mock
+#pragma once
+
+#include <new>
+
+template <typename T>
+class Placeholder {
+public:
+  T* operator&() { return reinterpret_cast<T*>(buf_); }
+  operator T&() { return *reinterpret_cast<T*>(buf_); }
+  operator const T&() const { return *reinterpret_cast<const T*>(buf_); }
+
+private:
+  alignas(T) unsigned char buf_[sizeof(T)];
+};
@@ -1,17 +1,28 @@
 // Simple tests for the project using desktop mocks
 #include <cassert>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
 
 // Include project headers (will use mocked Arduino + libs)
+#include "API_Actuator.h"
 #include "API_Control_PID.h"
+#include "API_ControlLoop.h"
+#include "API_JsonWriter.h"
+#include "API_RunConfig.h"
 #include "API_MyTimer.h"
+#include "API_Pid.h"
+#include "API_PidBank.h"
+#include "API_Pwm.h"
 #include "API_Resistor.h"
 #include "API_Sensors.h"
+#include "API_Sampler.h"
 
 // Mocks
 #include "tests/mocks/Arduino.h"
 #include "tests/mocks/DallasTemperature.h"
+#include "tests/mocks/esp_timer.h"
 
 static void test_pid_basic() {
   PID_config cfg = {0,0,30.0f, 0.5f, 0.1f, 1.0f, 1.0f, 0.0f, 2.0f, 0.0f};
@@ -24,6 +35,127 @@ static void test_pid_basic() {
   assert(std::abs(u - 2.0f) < 1e-5);
 }
 
+// Lazo de la barra con la temperatura en Temp_raw y u en milésimas
+struct Test_pid {
+  static constexpr float kp()      { return 0.354456662137341f; }
+  static constexpr float ki()      { return 0.000259315631755468f; }
+  static constexpr float ts()      { return 1.0f; }
+  static constexpr float kb()      { return 1.0f; }
+  static constexpr float u_max()   { return 2.32f; }
+  static constexpr float u_min()   { return 0.0f; }
+  static constexpr float y_units() { return 16.0f; }
+  static constexpr float u_units() { return 1000.0f; }
+};
+
+static void test_pid_template() {
+  // Coeficientes resueltos al compilar
+  static_assert(Pid<Q16_16, Test_pid>::coefs().ki_ts == 17, "KI*Ts en Q16.16");
+  static_assert(Pid<Q16_16, Test_pid>::coefs().u_max == 152044, "u_max en Q16.16");
+  static_assert(Pid<int32_t, Test_pid>::coefs().u_max == 2320, "u_max en milésimas");
+  constexpr float ki_ts = Pid<float, Test_pid>::coefs().ki_ts;
+  static_assert(ki_ts > 0.000259f && ki_ts < 0.00026f, "KI*Ts en float");
+
+  // Mismo lazo sobre una planta de primer orden en las tres variantes
+  Pid<float, Test_pid> pf;
+  Pid<Q16_16, Test_pid> pq;
+  Pid<int32_t, Test_pid> pi;
+  pf.set_reference(30.0f);
+  pq.set_reference(Q16_16::from_float(30.0f));
+  pi.set_reference(30 * TEMP_RAW_ONE_C);
+  float yf = 20, yq = 20, yi = 20;
+  for (int k = 0; k < 12000; k++) {
+    float uf = pf.update(yf);
+    float uq = pq.update(Q16_16::from_float(yq)).to_float();
+    float ui = pi.update(temp_c_to_raw(yi)) / 1000.0f;
+    assert(uf >= 0 && uf <= 2.32f && uq >= 0 && uq <= 2.33f && ui >= 0 && ui <= 2.32f);
+    yf += 0.01f * (20 + 8 * uf - yf);
+    yq += 0.01f * (20 + 8 * uq - yq);
+    yi += 0.01f * (20 + 8 * ui - yi);
+  }
+  // Todas convergen a la referencia (la entera, a la resolución de Temp_raw)
+  assert(std::abs(yf - 30) < 0.01f && std::abs(yq - yf) < 0.02f && std::abs(yi - yf) < 0.1f);
+
+  // El envoltorio con Config da lo mismo que con PID_config
+  API_Control_PID a, b;
+  a.configure<Test_pid>();
+  PID_config cfg = {0,0,0, Test_pid::kp(), Test_pid::ki(), 1, 1, 0, 2.32f, 0};
+  b.configure(cfg);
+  a.set_reference(30); b.set_reference(30);
+  for (int k = 0; k < 10; k++) assert(a.update(25.0f + k) == b.update(25.0f + k));
+}
+
+static void test_pid_bank() {
+  // 4 nodos con referencias propias; cada canal = un Pid<float> escalar
+  Pid_bank<4> bank;
+  Pid<float, Test_pid> ref[4];
+  const float sp[4] = {28, 30, 32, 35};
+  for (int c = 0; c < 4; c++) {
+    bank.configure<Test_pid>(c);
+    bank.set_reference(c, sp[c]);
+    ref[c].set_reference(sp[c]);
+  }
+  bank.enable(3, false);
+  float y[4] = {20, 20, 20, 20}, u[4];
+  for (int k = 0; k < 500; k++) {
+    bank.update(y, u);
+    for (int c = 0; c < 3; c++) {
+      assert(std::abs(u[c] - ref[c].update(y[c])) < 1e-5f);
+      y[c] += 0.01f * (20 + 8 * u[c] - y[c]);
+    }
+    assert(u[3] == 0);
+  }
+  assert(bank.integrator(3) == 0 && bank.integrator(2) > bank.integrator(0));
+}
+
+// Paso de prueba: registra el dt y consume el tiempo pedido
+static float g_step_dt = 0;
+static unsigned int g_step_cost_us = 0;
+static void fake_control_step(float dt_s, void*) {
+  g_step_dt = dt_s;
+  delayMicroseconds(g_step_cost_us);
+}
+
+static void test_control_loop() {
+  API_ControlLoop loop;
+  assert(loop.begin(fake_control_step, nullptr, 1000000));
+  int64_t t0 = 5000000;
+  // Primer paso: dt nominal, sin retardo
+  __mock_set_millis(t0 / 1000); g_step_cost_us = 200;
+  loop.run_step(esp_timer_get_time());
+  assert(std::abs(g_step_dt - 1.0f) < 1e-6f);
+  // Tick 300 us tarde: dt real 1.0003 s, bin [200, 400) de retardo
+  __mock_set_millis((t0 + 1000000) / 1000); delayMicroseconds(300);
+  loop.run_step(esp_timer_get_time());
+  assert(std::abs(g_step_dt - 1.0003f) < 1e-6f);
+  Control_stats st = loop.get_stats();
+  assert(st.steps == 2 && st.misses == 0 && st.last_jitter_us == 300);
+  assert(st.jitter_hist[0] == 1 && st.jitter_hist[3] == 1 && st.last_exec_us == 200);
+  // Paso que se pasa del deadline
+  g_step_cost_us = CONTROL_DEADLINE_US + 1000;
+  __mock_set_millis((t0 + 2000000) / 1000);
+  loop.run_step(esp_timer_get_time());
+  st = loop.get_stats();
+  assert(st.misses == 1 && st.max_exec_us == CONTROL_DEADLINE_US + 1000);
+  // Dos ticks perdidos (loop bloqueado): se cuentan y la grilla se reengancha
+  g_step_cost_us = 0;
+  __mock_set_millis((t0 + 5000000) / 1000); delayMicroseconds(50);
+  loop.run_step(esp_timer_get_time());
+  st = loop.get_stats();
+  assert(st.misses == 3 && st.last_jitter_us == 50 && std::abs(st.last_dt_s - 3.00005f) < 1e-5f);
+  assert(st.jitter_hist[1] == 1 && st.max_jitter_us == 300);
+  assert(API_ControlLoop::bin_limit_us(0) == CONTROL_JITTER_BIN0_US &&
+         API_ControlLoop::bin_limit_us(CONTROL_JITTER_BINS - 1) == 0);
+
+  // PID con dt real: dt = Ts igual a update(y); dt = 2 Ts duplica el paso integral
+  PID_config cfg = {0,0,30.0f, 0.1f, 0.01f, 1.0f, 1.0f, 0.0f, 100.0f, 0.0f};
+  API_Control_PID a, b;
+  a.configure(cfg); b.configure(cfg);
+  assert(a.update(25.0f, 1.0f) == b.update(25.0f));
+  float u_a = a.update(25.0f, 2.0f), u_b = b.update(25.0f);
+  assert(u_a == u_b);                                   // el integrador entra en el paso siguiente
+  assert(std::abs(a.update(25.0f) - b.update(25.0f) - 0.01f * 5.0f) < 1e-5f);
+}
+
 static void test_timer_minutes() {
   API_MyTimer t;
   __mock_set_millis(0);
@@ -51,10 +183,281 @@ static void test_resistor_heat_calc() {
   assert(std::abs(h - expected) < 1e-3f);
 }
 
+// Tensión PWM sin filtrar: fondo de escala durante el 25 % de cada periodo
+static int fake_adc_pwm_quarter(int) {
+  unsigned long period_us = 1000000UL / RESISTOR_FREQ;
+  return (micros() % period_us) < period_us / 4 ? 4095 : 0;
+}
+
+static void test_resistor_pwm_average() {
+  __mock_set_millis(1000);
+  __mock_set_analog_cb(fake_adc_pwm_quarter);
+  API_Resistor r;
+  float v_full = 3.3f * READ_TO_REAL_VOLTAGE;
+  float p_full = v_full * v_full / RESISTOR_VALUE;
+  // La ventana cubre periodos completos: potencia media = 25 % de plena
+  unsigned long t0 = micros();
+  r.sample_window();
+  assert(micros() - t0 >= RESISTOR_ADC_PERIODS * 1000000UL / RESISTOR_FREQ - 1000000UL / RESISTOR_FREQ);
+  assert(std::abs(r.get_heat() - 0.25f * p_full) < 0.02f * p_full);
+  // get_heat() no vuelve a leer el ADC
+  __mock_set_analog_cb(fake_adc_half_scale);
+  assert(std::abs(r.get_heat() - 0.25f * p_full) < 0.02f * p_full);
+  assert(r.get_heat_windows() == 2);   // init() + la ventana explícita
+}
+
+static void test_pwm_output() {
+  // 16 bits no entran a 5 kHz: baja a 13 (80 MHz / 5 kHz = 16000 cuentas)
+  API_Pwm cooler(4, 1, 5000, 16);
+  assert(cooler.begin() && cooler.get_bits() == 13 && __mock_ledc_bits[1] == 13);
+  cooler.write(33.3f);
+  assert(__mock_ledc_duty[1] == (uint32_t)(0.333f * 8192 + 0.5f));
+  cooler.write(150);
+  assert(__mock_ledc_duty[1] == 8192 && cooler.get_percent() == 100);
+  cooler.write(-5);
+  assert(__mock_ledc_duty[1] == 0);
+
+  // Calefactor: el % en float llega al LEDC sin truncar
+  API_Resistor r;
+  assert(r.get_pwm_bits() == RESISTOR_RESOLUTION);
+  r.set_pwm(12.34f);
+  assert(std::abs(r.get_set_pwm_percent() - 12.34f) < 1e-6f);
+  // El pedido llega al LEDC en la tarea del ADC, no en set_pwm()
+  assert(r.get_pwm_output() == 0);
+  r.update_output();
+  assert(__mock_ledc_duty[RESISTOR_CHANNEL] == (uint32_t)(0.1234f * (1 << RESISTOR_RESOLUTION) + 0.5f));
+  r.set_pwm(0);
+  r.update_output();
+
+  // Sigma-delta a 8 bits: la media sigue al objetivo por debajo de 1 LSB
+  API_Pwm d(5, 2, 1000, 8, true);
+  assert(d.begin());
+  d.write(10.1f);                      // 25.856 cuentas
+  uint32_t sum = 0;
+  for (int i = 0; i < 1000; i++) {
+    d.update();
+    uint32_t duty = __mock_ledc_duty[2];
+    assert(duty == 25 || duty == 26);
+    sum += duty;
+  }
+  assert(std::abs(sum / 1000.0f - 25.856f) < 2e-3f);
+}
+
+static void test_actuator() {
+  __mock_set_millis(1000);
+  API_Actuator a(4, 1, 5000, 12);
+  assert(a.begin());
+  // El mismo valor en cada loop() no vuelve al LEDC
+  unsigned long w0 = __mock_ledc_writes;
+  for (int i = 0; i < 100; i++) { a.set(50); a.update(); }
+  Actuator_stats st = a.get_stats();
+  assert(st.requests == 100 && st.changes == 1 && st.writes == 1);
+  assert(__mock_ledc_writes - w0 == 1 && __mock_ledc_duty[1] == 2048);
+  // Un cambio por debajo de 1 LSB se acepta pero no escribe
+  a.set(50.001f);
+  assert(a.get_stats().changes == 2 && a.get_stats().writes == 1);
+
+  // Rampa de subida 10 %/s: la aplica update(); bajar sin límite
+  a.set_ramp(10, 0);
+  a.update();
+  a.set(60);
+  assert(a.get_output() == 50.001f);
+  __mock_set_millis(1500); a.update();
+  assert(std::abs(a.get_output() - 55.001f) < 1e-3f);
+  assert(a.get_stats().last_latency_us == 500000);
+  __mock_set_millis(2500); a.update();
+  assert(a.get_output() == 60 && __mock_ledc_duty[1] == (uint32_t)(0.6f * 4096 + 0.5f));
+  __mock_set_millis(2600); a.set(0); a.update();
+  assert(a.get_output() == 0 && __mock_ledc_duty[1] == 0);
+  st = a.get_stats();
+  assert(st.last_latency_us == 0 && st.max_latency_us == 500000);
+
+  // Calefactor: runFijo reescribe el mismo % cada segundo; la tarea del
+  // ADC lo aplica en cada ventana
+  API_Resistor r;
+  Actuator_stats h0 = r.get_pwm_stats();
+  for (int i = 0; i < 10; i++) { r.set_pwm(30); r.update_output(); }
+  Actuator_stats h = r.get_pwm_stats();
+  assert(h.requests - h0.requests == 10 && h.writes - h0.writes == 1);
+  assert(r.get_pwm_output() == 30);
+  r.set_pwm(0);
+  r.update_output();
+}
+
+static void test_resistor_calibration() {
+  __mock_nvs_clear();
+  __mock_set_analog_cb(fake_adc_half_scale);
+  API_Resistor r;
+  assert(r.get_calibration() == RESISTOR_CAL_EFUSE_TP);
+  // Dos puntos: 0 -> 0 mV, 4095 -> 3000 mV (pin); tabla código -> W
+  assert(!r.set_two_point_calibration(4095, 0, 0, 3000));
+  assert(r.set_two_point_calibration(0, 0, 4095, 3000));
+  assert(r.get_calibration() == RESISTOR_CAL_TWO_POINT);
+  r.sample_window();
+  float v = 2048.0f * 3.0f / 4095.0f * READ_TO_REAL_VOLTAGE;
+  float expected = v * v / RESISTOR_VALUE;
+  assert(std::abs(r.get_heat() - expected) < 1e-3f);
+  // Sin coeficiente de temperatura la corrección es neutra
+  r.set_temperature(60.0f);
+  r.sample_window();
+  if (RESISTOR_TEMPCO == 0) assert(std::abs(r.get_heat() - expected) < 1e-3f);
+
+  // Otro arranque: eFuse hasta cargar la calibración guardada
+  API_Resistor r2;
+  assert(r2.get_calibration() == RESISTOR_CAL_EFUSE_TP);
+  r2.load_calibration();
+  assert(r2.get_calibration() == RESISTOR_CAL_TWO_POINT);
+  r2.sample_window();
+  assert(std::abs(r2.get_heat() - expected) < 1e-3f);
+  __mock_nvs_clear();
+}
+
+static void test_resistor_energy() {
+  __mock_set_analog_cb(fake_adc_half_scale);
+  unsigned long t = 1000;
+  __mock_set_millis(t);
+  API_Resistor r;
+  r.set_pwm(40);
+  r.update_output();
+  // Fuera de corrida sólo crece el total
+  __mock_set_millis(t += 100); r.sample_window();
+  Heater_energy e = r.get_energy();
+  assert(!e.run_active && e.run_j == 0 && e.total_j > 0);
+  float total0 = e.total_j;
+
+  // Corrida PID sobre el nodo 2: 10 ventanas de 100 ms tras el pedido
+  r.begin_run(1);
+  r.set_energy_node(2);
+  __mock_set_millis(t += 100); r.sample_window();
+  for (int i = 0; i < 10; i++) { __mock_set_millis(t += 100); r.sample_window(); }
+  e = r.get_energy();
+  assert(e.run_active && e.run_mode == 1);
+  assert(std::abs(e.run_s - 1.0f) < 1e-4f);
+  assert(std::abs(e.run_j - r.get_heat() * 1.0f) < 1e-3f);
+  assert(std::abs(e.run_duty - 40.0f) < 1e-3f);
+  assert(e.mode_j[0] == 0 && std::abs(e.mode_j[1] - e.run_j) < 1e-6f);
+  assert(std::abs(e.node_j[2] - e.run_j) < 1e-6f && e.node_j[1] == 0);
+  assert(e.total_j > total0 + e.run_j - 1e-3f);
+
+  // Fin: la corrida queda congelada; una corrida nueva reinicia sólo run_*
+  r.end_run();
+  __mock_set_millis(t += 100); r.sample_window();
+  __mock_set_millis(t += 100); r.sample_window();
+  Heater_energy done = r.get_energy();
+  assert(!done.run_active && std::abs(done.run_j - e.run_j) < 0.2f * r.get_heat());
+  r.begin_run(0);
+  __mock_set_millis(t += 100); r.sample_window();
+  __mock_set_millis(t += 100); r.sample_window();
+  e = r.get_energy();
+  assert(std::abs(e.run_s - 0.1f) < 1e-4f && std::abs(e.mode_j[1] - done.mode_j[1]) < 1e-6f);
+  assert(std::abs(e.mode_j[0] - e.run_j) < 1e-6f);
+}
+
+static void test_temp_raw_format() {
+  char buf[TEMP_RAW_TEXT_MAX];
+  struct { Temp_raw raw; const char* text; } cases[] = {
+    {0x0191, "25.06"}, {0, "0.00"}, {-1, "-0.06"}, {-162, "-10.13"},
+    {125 * TEMP_RAW_ONE_C, "125.00"}, {-55 * TEMP_RAW_ONE_C, "-55.00"}, {TEMP_RAW_POWER_ON, "85.00"},
+    {INT16_MIN, "-2048.00"}, {INT16_MAX, "2047.94"},
+  };
+  for (auto& c : cases) {
+    int n = temp_raw_format(buf, c.raw);
+    assert(std::strcmp(buf, c.text) == 0 && n == (int)std::strlen(c.text));
+  }
+  assert(temp_c_to_raw(26.5f) == 424 && temp_c_to_raw(-0.5f) == -8);
+  assert(std::abs(temp_raw_to_c(0x0191) - 25.0625f) < 1e-6f);
+}
+
+static void test_json_writer() {
+  char buf[256];
+  API_JsonWriter w(buf, sizeof(buf));
+  w.begin_object();
+  w.field("seq", 42u);
+  w.field("age_ms", -1);
+  w.field("running", true);
+  w.field("mode", "pid");
+  w.field("sp", 30.25f, 1);
+  w.key("t"); w.begin_array();
+  w.value_temp(0x0191); w.value_temp(-162); w.value_null();
+  w.end_array();
+  w.key("e"); w.begin_object(); w.end_object();
+  w.field("neg", -0.004f, 2);
+  w.field("x", -12.3456f, 3);
+  w.field("big", 4000000000UL);
+  w.field("nan", NAN, 2);
+  w.field("s", "a\"b\\c\n\x01");
+  w.end_object();
+  assert(w.ok());
+  const char* expected =
+    "{\"seq\":42,\"age_ms\":-1,\"running\":true,\"mode\":\"pid\",\"sp\":30.3,"
+    "\"t\":[25.06,-10.13,null],\"e\":{},\"neg\":0.00,\"x\":-12.346,\"big\":4000000000,"
+    "\"nan\":null,\"s\":\"a\\\"b\\\\c\\n\\u0001\"}";
+  assert(std::strcmp(w.c_str(), expected) == 0 && w.length() == std::strlen(expected));
+
+  // Cota según los decimales: 2^43 entra en int64 con 6 decimales, 2^44 no
+  char wide[64];
+  API_JsonWriter b(wide, sizeof(wide));
+  b.begin_array();
+  b.value(8796093022208.0f, 6); b.value(-17592186044416.0f, 6); b.value(17592186044416.0f, 0);
+  b.end_array();
+  assert(std::strcmp(b.c_str(), "[8796093022208.000000,null,17592186044416]") == 0);
+
+  // Sin lugar: ok() = false, sin escribir fuera del búfer
+  char small[8];
+  API_JsonWriter t(small, sizeof(small));
+  t.begin_object(); t.field("temperature", 1); t.end_object();
+  assert(!t.ok() && std::strlen(small) < sizeof(small));
+}
+
+static void test_run_config() {
+  API_RunConfig cfg(30.0f, 0, 100);
+  Run_config c = cfg.get();
+  assert(c.version == 0 && c.mode == RUN_MODE_FIXED && c.node == 1 && c.cooler_percent == 100);
+
+  // Documento parcial: sólo cambian los campos presentes, una versión
+  Run_config_patch p;
+  assert(API_RunConfig::parse(" {\"mode\":\"pid\", \"node\":3,\"setpoint\":35.5} ", p) == NULL);
+  assert(p.fields == (RUN_CFG_MODE | RUN_CFG_NODE | RUN_CFG_SETPOINT));
+  Run_config out;
+  assert(cfg.apply(p, &out) == NULL);
+  c = cfg.get();
+  assert(c.version == 1 && out.version == 1);
+  assert(c.mode == RUN_MODE_PID && c.node == 3 && c.setpoint == 35.5f);
+  assert(c.fixed_percent == 0 && c.cooler_percent == 100);
+
+  // Un campo inválido rechaza el documento entero: nada se aplica
+  char doc[64];
+  std::snprintf(doc, sizeof(doc), "{\"cooler_percent\":40,\"node\":%d}", DEVICES_CONNECT);
+  assert(API_RunConfig::parse(doc, p) == NULL);
+  assert(cfg.apply(p) != NULL);
+  c = cfg.get();
+  assert(c.version == 1 && c.cooler_percent == 100 && c.node == 3);
+
+  // Errores de formato y claves desconocidas
+  assert(API_RunConfig::parse("{\"mode\":\"auto\"}", p) != NULL);
+  assert(API_RunConfig::parse("{\"node\":2.5}", p) != NULL);
+  assert(API_RunConfig::parse("{\"nodes\":2}", p) != NULL);
+  assert(API_RunConfig::parse("{\"node\":2", p) != NULL);
+  assert(API_RunConfig::parse("{\"node\":2} x", p) != NULL);
+  assert(API_RunConfig::parse("{\"setpoint\":95}", p) == NULL && cfg.apply(p) != NULL);
+
+  // Documento completo
+  assert(API_RunConfig::parse("{\"mode\":\"fixed\",\"node\":1,\"setpoint\":40,"
+                              "\"fixed_percent\":25,\"cooler_percent\":66}", p) == NULL);
+  assert(cfg.apply(p) == NULL);
+  c = cfg.get();
+  assert(c.version == 2 && c.mode == RUN_MODE_FIXED && c.node == 1 && c.setpoint == 40.0f);
+  assert(c.fixed_percent == 25 && c.cooler_percent == 66);
+  // Vacío: válido, no cambia nada
+  assert(API_RunConfig::parse("{}", p) == NULL && p.fields == 0);
+  assert(cfg.apply(p) == NULL && cfg.get().version == 2);
+}
+
 static void test_sensors_read() {
   DallasTemperature::__mock_set_devices(DEVICES_CONNECT); // avoid restart
   DallasTemperature::__mock_set_base_temp(23.0f);
   API_Sensors s;
+  s.init();
   float v[DEVICES_CONNECT] = {0};
   s.getTemperatures(v);
   // With base 23 and +i%5, first 5 calls produce values >= 23
@@ -63,12 +466,465 @@ static void test_sensors_read() {
   }
 }
 
+static void test_sensors_rom_table() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  API_Sensors s;
+  s.init();
+  assert(s.get_device_count() == DEVICES_CONNECT);
+  // Las lecturas no deben volver a recorrer el bus
+  int searches = __mock_onewire_bus_at(ONE_WIRE_BUS).searches;
+  float v[DEVICES_CONNECT] = {0};
+  for (int k=0;k<3;k++) s.getTemperatures(v);
+  assert(__mock_onewire_bus_at(ONE_WIRE_BUS).searches == searches);
+  // Un sensor desaparece: rescan() lo refleja
+  __mock_onewire_bus_at(ONE_WIRE_BUS).present[4] = false;
+  assert(s.rescan() == DEVICES_CONNECT-1);
+  __mock_onewire_bus_at(ONE_WIRE_BUS).present[4] = true;
+  assert(s.rescan() == DEVICES_CONNECT);
+}
+
+static void test_sensors_async_poll() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_base_temp(23.0f);
+  __mock_set_millis(10000);
+  API_Sensors s;
+  s.init();
+  assert(s.latest().seq == 0);
+  // Primer poll: lanza la conversión y retorna sin esperar
+  unsigned long t0 = millis();
+  assert(!s.poll());
+  assert(millis() == t0);
+  __mock_set_millis(t0 + 100);
+  assert(!s.poll());
+  // 12 bits: 750 ms
+  __mock_set_millis(t0 + 750);
+  assert(s.poll());
+  assert(s.latest().seq == 1);
+  assert(s.latest().timestamp_ms == t0 + 750);
+  for (int i=0;i<DEVICES_CONNECT;i++) assert(s.latest().temps_raw[i] >= 23 * TEMP_RAW_ONE_C);
+  // Siguiente conversión recién al cumplirse el período
+  assert(!s.poll());
+  __mock_set_millis(t0 + SENSORS_CONTROL_PERIOD);
+  assert(!s.poll());
+  __mock_set_millis(t0 + SENSORS_CONTROL_PERIOD + 750);
+  assert(s.poll());
+  assert(s.latest().seq == 2);
+}
+
+static void test_sensors_multirate() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  __mock_set_millis(30000);
+  API_Sensors s;
+  s.init();
+  s.set_control_node(2);
+  int all0 = DallasTemperature::__mock_requests();
+  int one0 = DallasTemperature::__mock_by_address_requests();
+  // Corre 10 s de muestreo en pasos de 10 ms
+  unsigned long t0 = millis();
+  uint32_t ctrl_updates = 0;
+  while (millis() - t0 < 10000) {
+    if (s.poll()) {
+      assert(s.latest().updated_mask & (1UL << 2));
+      ctrl_updates++;
+    }
+    __mock_set_millis(millis() + 10);
+  }
+  int all = DallasTemperature::__mock_requests() - all0;
+  int one = DallasTemperature::__mock_by_address_requests() - one0;
+  // Todo el bus cada SENSORS_AUX_PERIOD, el nodo de control cada SENSORS_CONTROL_PERIOD
+  assert(all == 2);
+  assert(one == 8);
+  assert(ctrl_updates == 10);
+}
+
+static void test_sensors_resolution() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_base_temp(25.0f);
+  DallasTemperature::__mock_set_ripple(1);   // temperaturas constantes
+  __mock_set_millis(50000);
+  API_Sensors s;
+  s.init();
+  s.set_control_node(1);
+  s.set_aux_period(60000);
+  for (int i=0;i<DEVICES_CONNECT;i++) assert(s.get_resolution(i) == SENSORS_RES_DEFAULT);
+  assert(API_Sensors::conversion_ms(9) == 94 && API_Sensors::conversion_ms(12) == 750);
+
+  // Pedido explícito: se aplica en el próximo arranque de conversión
+  assert(s.set_resolution(3, 9));
+  assert(!s.set_resolution(3, 13));
+  int writes = DallasTemperature::__mock_resolution_writes();
+  while (!s.poll()) __mock_set_millis(millis() + 10);
+  assert(s.get_resolution(3) == 9);
+  assert(s.latest().resolution[3] == 9);
+  assert(DallasTemperature::__mock_resolution_writes() == writes + 1);
+
+  // Régimen: el nodo de control sigue a 12 bits
+  for (int k=0;k<3;k++) { __mock_set_millis(millis() + 10); while (!s.poll()) __mock_set_millis(millis() + 10); }
+  assert(s.get_resolution(1) == SENSORS_RES_DEFAULT);
+
+  // Transitorio: salto de temperatura -> el nodo de control baja a 10 bits
+  DallasTemperature::__mock_set_base_temp(30.0f);
+  __mock_set_millis(millis() + 10);
+  while (!s.poll()) __mock_set_millis(millis() + 10);
+  __mock_set_millis(millis() + 10);
+  while (s.ms_to_next_event() > 0) __mock_set_millis(millis() + 10);
+  s.poll();   // arranca la conversión del nodo de control
+  assert(s.get_resolution(1) == SENSORS_RES_TRANSIENT);
+  unsigned long t0 = millis();
+  while (!s.poll()) __mock_set_millis(millis() + 1);
+  assert(millis() - t0 <= API_Sensors::conversion_ms(SENSORS_RES_TRANSIENT) + 1UL);
+  DallasTemperature::__mock_set_ripple(5);
+}
+
+static void test_sampler_snapshot() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_base_temp(23.0f);
+  __mock_set_analog_cb(fake_adc_half_scale);
+  __mock_set_millis(20000);
+  API_Sensors s;
+  s.init();
+  API_Resistor r;
+  API_Sampler sampler;
+  assert(sampler.begin(&s, &r));
+  assert(sampler.snapshot().seq == 0);
+  // La tarea no corre en host: se avanza a mano
+  while (!sampler.step()) __mock_set_millis(millis() + 10);
+  Sample_snapshot snap = sampler.snapshot();
+  assert(snap.seq == 1);
+  assert(snap.timestamp_ms == millis());
+  assert(std::abs(snap.heater_w - r.get_heat()) < 1e-6f);
+  for (int i=0;i<DEVICES_CONNECT;i++) assert(snap.temps_raw[i] >= 23 * TEMP_RAW_ONE_C);
+}
+
+static void test_sensors_fast_read() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_base_temp(25.0f);
+  DallasTemperature::__mock_set_ripple(1);
+  API_Sensors s;
+  s.init();
+  float v[DEVICES_CONNECT] = {0};
+  int bytes0 = DallasTemperature::__mock_scratchpad_bytes();
+  for (int k=0;k<21;k++) s.getTemperatures(v);
+  // Por sensor: una completa (9 bytes) cada SENSORS_FULL_READ_EVERY, el
+  // resto rápidas (2 bytes): lecturas 1, 11 y 21 completas
+  int per_sensor = 3*9 + 18*2;
+  assert(DallasTemperature::__mock_scratchpad_bytes() - bytes0 == DEVICES_CONNECT * per_sensor);
+  for (int i=0;i<DEVICES_CONNECT;i++) assert(std::abs(v[i] - 25.0f) < 1e-3f);
+
+  // Salto implausible: la lectura rápida se descarta y se verifica completa
+  DallasTemperature::__mock_set_base_temp(35.0f);
+  bytes0 = DallasTemperature::__mock_scratchpad_bytes();
+  s.getTemperatures(v);
+  assert(DallasTemperature::__mock_scratchpad_bytes() - bytes0 == DEVICES_CONNECT * (2 + 9));
+  for (int i=0;i<DEVICES_CONNECT;i++) assert(std::abs(v[i] - 35.0f) < 1e-3f);
+
+  // Modo rápido desactivado: siempre 9 bytes
+  s.set_fast_read(false);
+  bytes0 = DallasTemperature::__mock_scratchpad_bytes();
+  s.getTemperatures(v);
+  assert(DallasTemperature::__mock_scratchpad_bytes() - bytes0 == DEVICES_CONNECT * 9);
+  DallasTemperature::__mock_set_ripple(5);
+}
+
+static void test_sensors_health() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_base_temp(25.0f);
+  DallasTemperature::__mock_set_ripple(1);
+  MockOneWireBus& b = __mock_onewire_bus_at(ONE_WIRE_BUS);
+  API_Sensors s;
+  s.init();
+  // Sin lectura rápida: el CRC se verifica en cada lectura
+  s.set_fast_read(false);
+  float v[DEVICES_CONNECT] = {0};
+  s.getTemperatures(v);
+  assert(s.get_health(2).failures == 0 && s.get_health(2).last_good_ms != 0);
+
+  // CRC corrupto: conserva el último valor y entra en backoff 1, 3...
+  b.fault[2] = MOCK_FAULT_CRC;
+  s.getTemperatures(v);
+  assert(s.get_health(2).crc_errors == 1 && s.get_health(2).backoff == 0);
+  s.getTemperatures(v);
+  assert(s.get_health(2).crc_errors == 2 && s.get_health(2).backoff == 1);
+  int bytes0 = DallasTemperature::__mock_scratchpad_bytes();
+  s.getTemperatures(v);   // salteado: sin tráfico para el sensor 2
+  assert(DallasTemperature::__mock_scratchpad_bytes() - bytes0 == (DEVICES_CONNECT - 1) * 9);
+  s.getTemperatures(v);
+  assert(s.get_health(2).crc_errors == 3 && s.get_health(2).backoff == 3);
+  assert(std::abs(v[2] - 25.0f) < 1e-3f);
+  b.fault[2] = MOCK_FAULT_NONE;
+  for (int k=0;k<4;k++) s.getTemperatures(v);
+  assert(s.get_health(2).failures == 0 && s.get_health(2).crc_errors == 3);
+
+  // Ausente (0xff) y bus en corto (ceros) cuentan como desconexión
+  b.present[3] = false;
+  s.getTemperatures(v);
+  b.present[3] = true;
+  b.fault[4] = MOCK_FAULT_SHORTED;
+  s.getTemperatures(v);
+  b.fault[4] = MOCK_FAULT_NONE;
+  assert(s.get_health(3).disconnects == 1 && s.get_health(3).crc_errors == 0);
+  assert(s.get_health(4).disconnects == 1);
+
+  // 85 °C de encendido: se descarta y se reprograma la resolución
+  b.fault[1] = MOCK_FAULT_POWER_ON;
+  s.getTemperatures(v);
+  b.fault[1] = MOCK_FAULT_NONE;
+  assert(s.get_health(1).power_on_resets == 1);
+  assert(std::abs(v[1] - 25.0f) < 1e-3f);
+  assert(s.get_resolution(1) == 0);
+
+  // Fuera de rango
+  DallasTemperature::__mock_set_base_temp(2.0f);
+  s.getTemperatures(v);
+  assert(s.get_health(0).out_of_range == 1 && std::abs(v[0] - 25.0f) < 1e-3f);
+  DallasTemperature::__mock_set_base_temp(25.0f);
+
+  // Valor trabado: una sola cuenta por racha
+  for (int k=0;k<SENSORS_STUCK_READS+5;k++) s.getTemperatures(v);
+  assert(s.get_health(0).stuck == 1 && s.get_health(0).failures == 0);
+  assert(s.latest().health[0].stuck == 1);
+  DallasTemperature::__mock_set_ripple(5);
+}
+
+// Avanza poll() hasta publicar la próxima muestra
+static const Sensors_sample& poll_next(API_Sensors& s) {
+  while (!s.poll()) __mock_set_millis(millis() + 10);
+  return s.latest();
+}
+
+static void test_sensors_monitor() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_base_temp(25.5f);
+  DallasTemperature::__mock_set_ripple(1);
+  MockOneWireBus& b = __mock_onewire_bus_at(ONE_WIRE_BUS);
+  __mock_set_millis(90000);
+  API_Sensors s;
+  s.init();
+  s.set_aux_period(1000);
+  s.set_monitor_mode(true);
+  uint32_t all = (1UL << DEVICES_CONNECT) - 1;
+
+  // Primer ciclo: se leen todos y se programan TH/TL alrededor de 25 °C
+  int writes0 = DallasTemperature::__mock_alarm_writes();
+  assert(poll_next(s).updated_mask == all);
+  assert(s.get_monitor_mode());
+  assert(DallasTemperature::__mock_alarm_writes() - writes0 == DEVICES_CONNECT);
+  assert(b.th[3] == 26 && b.tl[3] == 24);
+
+  // Régimen: la búsqueda de alarmas no encuentra nada, no se lee scratchpad
+  int bytes0 = DallasTemperature::__mock_scratchpad_bytes();
+  int one0 = DallasTemperature::__mock_by_address_requests();
+  for (int k=0;k<3;k++) assert(poll_next(s).updated_mask == 0);
+  assert(DallasTemperature::__mock_scratchpad_bytes() == bytes0);
+  assert(DallasTemperature::__mock_by_address_requests() == one0);
+
+  // Sólo se lee (y se reprograma) el sensor que salió de su grado
+  b.offset[3] = 1.0f;
+  const Sensors_sample& m = poll_next(s);
+  assert(m.updated_mask == (1UL << 3));
+  assert(m.temps_raw[3] == temp_c_to_raw(26.5f));
+  assert(b.th[3] == 27 && b.tl[3] == 25);
+  assert(poll_next(s).updated_mask == 0);
+
+  // Refresco periódico de todos los sensores
+  bool refreshed = false;
+  for (int k=0;k<SENSORS_MONITOR_REFRESH;k++) refreshed |= poll_next(s).updated_mask == all;
+  assert(refreshed);
+
+  // Fuera del modo monitoreo se vuelve a leer todo en cada ciclo completo
+  s.set_monitor_mode(false);
+  assert(poll_next(s).updated_mask == all);
+  b.offset[3] = 0;
+  DallasTemperature::__mock_set_ripple(5);
+}
+
+static void test_sensors_role_map() {
+  DallasTemperature::__mock_set_devices(DEVICES_CONNECT);
+  DallasTemperature::__mock_set_ripple(1);
+  MockOneWireBus& b = __mock_onewire_bus_at(ONE_WIRE_BUS);
+  __mock_set_millis(120000);
+  Sensor_rom rom2, rom4, r;
+  {
+    // Primer arranque: búsqueda y mapa guardado en orden de búsqueda
+    API_Sensors s;
+    s.init();
+    assert(s.get_map_verified() && s.get_device_count() == DEVICES_CONNECT);
+    assert(s.get_rom(2, rom2) && std::memcmp(rom2, b.roms[2], 8) == 0);
+    assert(s.get_rom(4, rom4));
+  }
+
+  // Reemplazo de la sonda del rol 2 (ROM nueva, primera en la búsqueda)
+  b.roms[2][1] = 0x01; b.roms[2][3] = 0x77; b.roms[2][7] = OneWire::crc8(b.roms[2], 7);
+  std::swap_ranges(b.roms[0], b.roms[0] + 8, b.roms[2]);
+  std::swap(b.resolution[0], b.resolution[2]);
+  Sensor_rom fresh;
+  std::memcpy(fresh, b.roms[0], 8);
+
+  API_Sensors s;
+  int searches0 = b.searches;
+  s.init();
+  // Arranque con mapa: sin búsqueda y mismos roles
+  assert(b.searches == searches0);
+  assert(!s.get_map_verified());
+  assert(s.get_rom(2, r) && std::memcmp(r, rom2, 8) == 0);
+  assert(s.get_rom(4, r) && std::memcmp(r, rom4, 8) == 0);
+
+  // La verificación en segundo plano marca el rol 2 y la ROM sin rol
+  for (int k=0;k<3;k++) poll_next(s);
+  while (!s.get_map_verified()) { s.poll(); __mock_set_millis(millis() + 10); }
+  assert(s.get_map_missing() == (1UL << 2));
+  int bus = -1;
+  assert(s.get_unknown_count() == 1 && s.get_unknown(0, r, &bus) && std::memcmp(r, fresh, 8) == 0 && bus == 0);
+  // El mapa publicado trae todo de la misma verificación
+  Sensors_map map = s.get_map();
+  assert(map.verified && map.missing == (1UL << 2) && map.bus[2] == 0 && std::memcmp(map.rom[2], rom2, 8) == 0);
+  assert(map.unknown_count == 1 && std::memcmp(map.unknown[0], fresh, 8) == 0 && map.unknown_bus[0] == 0);
+  assert(s.get_health(2).failures > 0);
+
+  // Reasignación: se aplica desde poll() y queda guardada
+  assert(!s.set_role(DEVICES_CONNECT, fresh));
+  assert(s.set_role(2, fresh));
+  poll_next(s);
+  assert(!s.remap_pending());
+  assert(s.get_rom(2, r) && std::memcmp(r, fresh, 8) == 0);
+  while (s.get_map_missing() || s.get_unknown_count()) { s.poll(); __mock_set_millis(millis() + 10); }
+  const Sensors_sample& m = poll_next(s);
+  assert(m.health[2].failures == 0 && s.get_resolution(2) == SENSORS_RES_DEFAULT);
+
+  // Intercambio de roles entre dos sensores conocidos
+  Sensor_rom rom1;
+  assert(s.get_rom(1, rom1));
+  assert(s.set_role(1, rom4));
+  poll_next(s);
+  assert(s.get_rom(1, r) && std::memcmp(r, rom4, 8) == 0);
+  assert(s.get_rom(4, r) && std::memcmp(r, rom1, 8) == 0);
+
+  // Tras reiniciar se conserva el mapa reasignado
+  API_Sensors s2;
+  s2.init();
+  assert(s2.get_rom(2, r) && std::memcmp(r, fresh, 8) == 0);
+  assert(s2.get_rom(1, r) && std::memcmp(r, rom4, 8) == 0);
+  DallasTemperature::__mock_set_ripple(5);
+}
+
+#if SENSORS_BUS_COUNT > 1
+static void test_sensors_multibus() {
+  // 3 sensores en el primer bus y 2 en el segundo
+  DallasTemperature::__mock_set_devices(3);
+  __mock_onewire_set_devices(DEVICES_CONNECT - 3, 16);
+  DallasTemperature::__mock_set_base_temp(23.0f);
+  __mock_set_millis(70000);
+  API_Sensors s;
+  s.init();
+  assert(s.get_device_count() == DEVICES_CONNECT);
+  assert(s.get_bus_of(0) == 0 && s.get_bus_of(2) == 0);
+  assert(s.get_bus_of(3) == 1 && s.get_bus_of(4) == 1);
+  // Conversión en ambos buses a la vez: el conjunto completo tarda lo
+  // que el bus más lento, no la suma
+  int req0 = DallasTemperature::__mock_requests();
+  unsigned long t0 = millis();
+  assert(!s.poll());
+  assert(DallasTemperature::__mock_requests() == req0 + 2);
+  while (!s.poll()) __mock_set_millis(millis() + 1);
+  assert(millis() - t0 == 750UL);
+  assert(s.latest().updated_mask == (1UL << DEVICES_CONNECT) - 1);
+  for (int i=0;i<DEVICES_CONNECT;i++) assert(s.latest().temps_raw[i] >= 23 * TEMP_RAW_ONE_C);
+}
+#endif
+
+// Servidor HTTP: los handlers son static, así que el archivo se compila
+// en este binario contra los mocks de WiFi/WebServer, con los globales que
+// en el firmware define main.cpp
+#include "../src/API_HttpServer.cpp"
+
+API_Sensors Temperature;
+API_Resistor Qin;
+API_Sampler Sampler;
+API_Actuator Cooler(4, 1, 25000, 8);
+API_ControlLoop Control;
+volatile bool g_running = false;
+API_RunConfig RunConfig(30.0f, 0, 100);
+
+static void test_http_state_size() {
+  // Peor caso de cada campo por sensor: /api/state entra en HTTP_JSON_BUF
+  // con DEVICES_CONNECT sensores (31 en el binario multibus)
+  Sample_snapshot snap = Sample_snapshot();
+  snap.seq = 0xFFFFFFFFUL;
+  snap.timestamp_ms = 0xFFFFFFFFUL;
+  snap.bus_time_us = 0xFFFFFFFFUL;
+  snap.heater_w = -9999.999f;
+  for (int i=0;i<DEVICES_CONNECT;i++) {
+    snap.temps_raw[i] = INT16_MIN;
+    snap.resolution[i] = 12;
+    Sensor_health& h = snap.health[i];
+    h.crc_errors = h.disconnects = h.power_on_resets = h.out_of_range = h.stuck = 0xFFFF;
+    h.failures = h.backoff = 0xFF;
+    h.last_good_ms = 1;
+  }
+  __mock_set_millis(0);
+  API_JsonWriter w(jsonBuf, sizeof(jsonBuf));
+  writeState(w, snap);
+  assert(w.ok());
+}
+
+// Pedido al WebServer mock: argumentos dados, devuelve el código HTTP
+static int http_call(Http_handler fn, std::initializer_list<std::pair<const char*, const char*>> args) {
+  server.__mock_args.clear();
+  for (auto& a : args) server.__mock_args[a.first] = a.second;
+  server.__mock_code = 0;
+  Http_req r;
+  r.buf = jsonBuf;
+  r.cap = sizeof(jsonBuf);
+  fn(r);
+  return server.__mock_code;
+}
+
+static void test_http_heater_calibration() {
+  __mock_nvs_clear();
+  int writes0 = __mock_nvs_writes;
+  // Valores que pasados a uint16_t caerían en rango: 65541 -> 5, -65000 -> 536
+  assert(http_call(handleHeaterCalibration, {{"raw_lo","65541"},{"mv_lo","0"},{"raw_hi","4095"},{"mv_hi","3000"}}) == 400);
+  assert(http_call(handleHeaterCalibration, {{"raw_lo","0"},{"mv_lo","0"},{"raw_hi","-65000"},{"mv_hi","3000"}}) == 400);
+  assert(http_call(handleHeaterCalibration, {{"raw_lo","0"},{"mv_lo","-65000"},{"raw_hi","4095"},{"mv_hi","3000"}}) == 400);
+  assert(http_call(handleHeaterCalibration, {{"raw_lo","0"},{"mv_lo","0"},{"raw_hi","4095"},{"mv_hi","69536"}}) == 400);
+  assert(http_call(handleHeaterCalibration, {{"raw_lo","0"},{"mv_lo","3000"},{"raw_hi","4095"},{"mv_hi","3000"}}) == 400);
+  assert(__mock_nvs_writes == writes0 && Qin.get_calibration() != RESISTOR_CAL_TWO_POINT);
+  assert(http_call(handleHeaterCalibration, {{"raw_lo","0"},{"mv_lo","0"},{"raw_hi","4095"},{"mv_hi","3000"}}) == 200);
+  assert(Qin.get_calibration() == RESISTOR_CAL_TWO_POINT);
+  __mock_nvs_clear();
+}
+
 int main() {
   std::cout << "Running tests...\n";
   test_pid_basic();
+  test_pid_template();
+  test_pid_bank();
+  test_control_loop();
   test_timer_minutes();
   test_resistor_heat_calc();
+  test_resistor_pwm_average();
+  test_pwm_output();
+  test_actuator();
+  test_resistor_calibration();
+  test_resistor_energy();
+  test_temp_raw_format();
+  test_json_writer();
+  test_run_config();
   test_sensors_read();
+  test_sensors_rom_table();
+  test_sensors_async_poll();
+  test_sensors_multirate();
+  test_sensors_resolution();
+  test_sampler_snapshot();
+  test_sensors_fast_read();
+  test_sensors_health();
+  test_sensors_monitor();
+  test_sensors_role_map();
+#if SENSORS_BUS_COUNT > 1
+  test_sensors_multibus();
+#endif
+  test_http_state_size();
+  test_http_heater_calibration();
   std::cout << "All tests passed.\n";
   return 0;
 }